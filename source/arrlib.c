@@ -7,9 +7,12 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 void quicksort(double x[], size_t first, size_t last);
 
+int compare(const void *a, const void *b);
+
 
 /* ~~~~~ Initialisations ~~~~~ */
 
@@ -22,6 +25,16 @@ void arr_init_linspace(double x[], double a, double rate, size_t N)
     }
 }
 
+// Fill array x with N points from a to b (both included), equidistant in the
+// logarithm (a, b > 0)
+void arr_init_logspace(double x[], double a, double b, size_t N)
+{
+    double step = ( N > 1 ) ? log(b / a) / (N-1) : 0;
+    for (size_t i = 0; i < N; ++i) {
+        x[i] = a * exp(i * step);
+    }
+}
+
 
 /* ~~~~~ Return value for single array ~~~~~ */
 
@@ -76,9 +89,25 @@ double arr_median(double x[], size_t N)
     return median;
 }
 
+// Maximum of array x
+double arr_max(double x[], size_t N)
+{
+    double max = x[0];
+    for (size_t i = 1; i < N; ++i) {
+        if ( x[i] > max ) max = x[i];
+    }
+    return max;
+}
+
 
 /* ~~~~~ Array operations on single array ~~~~~ */
 
+// Sort array x in ascending order -- IN-PLACE
+void arr_sort(double x[], size_t N)
+{
+    if ( N > 0 ) quicksort(x, 0, N-1);
+}
+
 // Add scalar a to array x -- IN-PLACE
 void arr_sca_add(double x[], double a, size_t N)
 {
@@ -112,35 +141,85 @@ size_t arr_util_getstep(double a, double b, double rate)
     return steps;      // Previously: steps-1;
 }
 
-// FOR MEDIAN: Sort array using (recursive) 'quicksort' algorithm
-void quicksort(double x[], size_t first, size_t last)
+// FOR WINDOWS: Points in steps of rate within +/- width around each of the
+//  K centres c (ascending). Overlapping windows are merged (no point closer
+//  than rate/2 to the previous one). Stores the points in x (if not NULL)
+//  and returns their number
+size_t arr_util_around(double c[], size_t K, double width, double rate,\
+                       double x[])
 {
-    double temp;
-    size_t pivot, i, j;
-    
-    if ( first < last ){
-        pivot = first;
-        i = first;
-        j = last;
-
-        while( i < j ){
-            while( x[i] <= x[pivot] && i < last )
-                i++;
-            while( x[j] > x[pivot] )
-                j--;
-            if( i < j ){
-                temp = x[i];
-                x[i] = x[j];
-                x[j] = temp;
-            }
+    size_t n = 0;
+    double last = 0;
+    for (size_t k = 0; k < K; ++k) {
+        size_t steps = arr_util_getstep(c[k] - width, c[k] + width, rate);
+        for (size_t i = 0; i < steps; ++i) {
+            double val = c[k] - width + i*rate;
+            if ( n > 0 && val < last + 0.5*rate ) continue;
+            if ( x != NULL ) x[n] = val;
+            last = val;
+            n++;
         }
+    }
+    return n;
+}
 
-        temp = x[pivot];
-        x[pivot] = x[j];
-        x[j] = temp;
-        quicksort(x, first, j-1);
-        quicksort(x, j+1, last);
+// FOR GRIDS: Check if the values of x (ascending) lie on a regular grid
+//  x0 + n*dx with integer n (within tol*dx). Returns the number of grid
+//  points spanned (last n + 1) and stores x0 and dx -- or 0 if not gridded
+size_t arr_util_cadence(double x[], size_t N, double tol, double *x0,\
+                        double *dx)
+{
+    if ( N < 2 ) return 0;
+
+    // Base step from the median difference
+    double* d = malloc((N-1) * sizeof(double));
+    arr_diff(x, d, N);
+    double step = arr_median(d, N-1);
+    free(d);
+    if ( step <= 0 ) return 0;
+
+    // Refine the step using the full span (avoids accumulating rounding)
+    double nlast = round((x[N-1] - x[0]) / step);
+    if ( nlast < 1 ) return 0;
+    step = (x[N-1] - x[0]) / nlast;
+
+    // Check all points
+    double r;
+    for (size_t i = 0; i < N; ++i) {
+        r = (x[i] - x[0]) / step;
+        if ( fabs(r - round(r)) > tol ) return 0;
     }
+
+    *x0 = x[0];
+    *dx = step;
+    return (size_t) nlast + 1;
 }
 
+// FOR GRIDS: Check if the values of x are equidistant (within tol*step)
+//  - Returns 1 if x[i] = x[0] + i*step for all i
+int arr_util_isuniform(double x[], size_t N, double tol)
+{
+    if ( N < 2 ) return 1;
+    double step = (x[N-1] - x[0]) / (N-1);
+    for (size_t i = 0; i < N; ++i) {
+        if ( fabs(x[i] - x[0] - i*step) > tol * fabs(step) ) return 0;
+    }
+    return 1;
+}
 
+// FOR MEDIAN: Sort array using the 'quicksort' of the C library
+//  - NOTE: The library version handles many equal values (e.g. the time steps
+//          of a regular cadence) without degrading or deep recursion
+void quicksort(double x[], size_t first, size_t last)
+{
+    if ( first < last )
+        qsort(&x[first], last - first + 1, sizeof(double), compare);
+}
+
+// FOR SORTING: Compare two doubles (ascending order)
+int compare(const void *a, const void *b)
+{
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return (da > db) - (da < db);
+}
@@ -4,6 +4,8 @@ void arr_init_frange(double x[], size_t N);
 
 void arr_init_linspace(double x[], double a, double rate, size_t N);
 
+void arr_init_logspace(double x[], double a, double b, size_t N);
+
 
 double arr_sum(double x[], size_t N);
 
@@ -11,6 +13,10 @@ double arr_mean(double x[], size_t N);
 
 double arr_median(double x[], size_t N);
 
+double arr_max(double x[], size_t N);
+
+
+void arr_sort(double x[], size_t N);
 
 void arr_sca_add(double x[], double a, size_t N);
 
@@ -18,3 +24,11 @@ void arr_diff(double x[], double y[], size_t N);
 
 
 size_t arr_util_getstep(double a, double b, double rate);
+
+size_t arr_util_cadence(double x[], size_t N, double tol, double *x0,\
+                        double *dx);
+
+int arr_util_isuniform(double x[], size_t N, double tol);
+
+size_t arr_util_around(double c[], size_t K, double width, double rate,\
+                       double x[]);
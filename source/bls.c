@@ -0,0 +1,209 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Box least squares (Kovacs, Zucker & Mazeh 2002): search for transits
+ *
+ * At each trial frequency the data is folded into phase bins (sums of the
+ * weights, weight*data and the number of points per bin, in one pass and
+ * without sorting). A box of `k` consecutive bins starting at bin `i` then
+ * has the sums P[i+k] - P[i] of the prefix sums P of the bins (continued
+ * cyclically by the longest box), so every start and duration costs O(1).
+ *
+ * With the weights normalised to a sum of 1 and the weighted mean removed,
+ * a box with the sums r (weights) and s (weight*data) reduces the weighted
+ * variance by
+ *     power = s^2 / (r (1 - r)) ,
+ * and the depth of the box is -s / (r (1 - r)). Only dips (s < 0) are
+ * considered. The frequencies are split among the threads, each with its
+ * own bins.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+// Min. number of points in a box (a single outlier is not a transit)
+#define BLSMINPTS 3
+
+
+void blsone(double time[], double x[], double w[], size_t N, double f,\
+            int nbins, int kmin, int kmax, double bins[], double *power,\
+            double *depth, double *q, double *phase, double *nin);
+
+
+/* Box least squares spectrum
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `flux`     : Array of data.
+ *  - `weight`   : Array of statistical weights.
+ *  - `freq`     : Array of cyclic trial frequencies (microHz).
+ *  - `N`        : Length of the time series
+ *  - `M`        : Length of the sampling vector
+ *  - `nbins`    : Number of phase bins
+ *  - `qmin`     : Shortest duration of the transit (fraction of the period)
+ *  - `qmax`     : Longest duration of the transit (fraction of the period)
+ *  - `power`    : OUTPUT -- Reduction of the (weighted) variance by the best
+ *                 box at each frequency
+ *  - `depth`    : OUTPUT -- Depth of the best box
+ *  - `q`        : OUTPUT -- Duration of the best box (fraction of the period)
+ *  - `phase`    : OUTPUT -- Phase of the middle of the best box (f * t)
+ *  - `snr`      : OUTPUT -- Signal-to-noise ratio of the depth: depth over
+ *                 its uncertainty sigma * sqrt(1/n_in + 1/n_out), with the
+ *                 (weighted) scatter sigma of the data and n points in and
+ *                 out of the box
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ */
+void blsspec(double time[], double flux[], double weight[], double freq[],\
+             size_t N, size_t M, int nbins, double qmin, double qmax,\
+             double power[], double depth[], double q[], double phase[],\
+             double snr[], int useweight)
+{
+    // Durations in bins
+    if ( nbins < 2 ) nbins = 2;
+    int kmin = (int) floor(qmin * nbins);
+    int kmax = (int) ceil(qmax * nbins);
+    if ( kmin < 1 ) kmin = 1;
+    if ( kmax < kmin ) kmax = kmin;
+    if ( kmax > nbins - 1 ) kmax = nbins - 1;
+    if ( kmin > kmax ) kmin = kmax;
+
+    // Normalised weights and data with the weighted mean removed
+    double* w = malloc(N * sizeof(double));
+    double* x = malloc(N * sizeof(double));
+    double wsum = 0;
+    double mean = 0;
+    for (size_t i = 0; i < N; ++i) {
+        w[i] = ( useweight != 0 ) ? weight[i] : 1;
+        wsum += w[i];
+        mean += w[i] * flux[i];
+    }
+    mean /= wsum;
+    double var = 0;
+    for (size_t i = 0; i < N; ++i) {
+        w[i] /= wsum;
+        x[i] = flux[i] - mean;
+        var += w[i] * x[i] * x[i];
+    }
+    double sigma = sqrt(var * N / (N - 1));
+
+    // Make parallel loop over all trial frequencies (bins per thread)
+    #pragma omp parallel default(shared)
+    {
+        double* bins = malloc(3 * (nbins + kmax + 1) * sizeof(double));
+        double nin;
+
+        #pragma omp for schedule(static)
+        for (size_t j = 0; j < M; ++j) {
+            blsone(time, x, w, N, freq[j] * 1e-6, nbins, kmin, kmax, bins,\
+                   &power[j], &depth[j], &q[j], &phase[j], &nin);
+            if ( nin > 0 && nin < N )
+                snr[j] = depth[j] / (sigma * sqrt(1.0/nin + 1.0/(N - nin)));
+            else
+                snr[j] = 0;
+        }
+
+        free(bins);
+    }
+
+    free(w);
+    free(x);
+}
+
+
+// Best box at the frequency f (Hz), for normalised weights w and data x
+// with the weighted mean removed. `bins` has room for 3 * (nbins + kmax + 1)
+void blsone(double time[], double x[], double w[], size_t N, double f,\
+            int nbins, int kmin, int kmax, double bins[], double *power,\
+            double *depth, double *q, double *phase, double *nin)
+{
+    // Prefix sums: weights, weight*data, number of points (P[0] = 0)
+    int L = nbins + kmax + 1;
+    double* Pw = bins;
+    double* Px = &bins[L];
+    double* Pn = &bins[2*L];
+    for (int k = 0; k < 3*L; ++k) {
+        bins[k] = 0;
+    }
+
+    // Fold (bin b is stored at b + 1)
+    double ph;
+    int b;
+    for (size_t i = 0; i < N; ++i) {
+        ph = f * time[i];
+        b = (int) ((ph - floor(ph)) * nbins);
+        if ( b >= nbins ) b = nbins - 1;
+        Pw[b+1] += w[i];
+        Px[b+1] += w[i] * x[i];
+        Pn[b+1] += 1;
+    }
+
+    // Continue cyclically by the longest box and accumulate
+    for (int k = 1; k <= kmax; ++k) {
+        Pw[nbins + k] = Pw[k];
+        Px[nbins + k] = Px[k];
+        Pn[nbins + k] = Pn[k];
+    }
+    for (int k = 1; k < L; ++k) {
+        Pw[k] += Pw[k-1];
+        Px[k] += Px[k-1];
+        Pn[k] += Pn[k-1];
+    }
+
+    // All starts and durations
+    double best = 0;
+    double r, s, p;
+    int ibest = 0;
+    int kbest = kmin;
+    for (int i = 0; i < nbins; ++i) {
+        for (int k = kmin; k <= kmax; ++k) {
+            s = Px[i+k] - Px[i];
+            if ( s >= 0 ) continue;
+            r = Pw[i+k] - Pw[i];
+            if ( r <= 0 || r >= 1 || Pn[i+k] - Pn[i] < BLSMINPTS ) continue;
+            p = s * s / (r * (1 - r));
+            if ( p > best ) {
+                best = p;
+                ibest = i;
+                kbest = k;
+            }
+        }
+    }
+
+    // Store the best box
+    r = Pw[ibest+kbest] - Pw[ibest];
+    s = Px[ibest+kbest] - Px[ibest];
+    *power = best;
+    *depth = ( best > 0 ) ? -s / (r * (1 - r)) : 0;
+    *q = (double) kbest / nbins;
+    *phase = (ibest + 0.5 * kbest) / nbins;
+    if ( *phase >= 1 ) *phase -= 1;
+    *nin = ( best > 0 ) ? Pn[ibest+kbest] - Pn[ibest] : 0;
+}
+
+
+/* The K highest peaks of a spectrum (local maxima, highest first)
+ *  --> Stores their indices in `idx` and returns their number (at most K)
+ */
+size_t bls_peaks(double power[], size_t M, size_t K, size_t idx[])
+{
+    size_t n = 0;
+    for (size_t j = 0; j < M; ++j) {
+        // Local maximum (plateaus count once)
+        if ( power[j] <= 0 ) continue;
+        if ( j > 0 && power[j-1] >= power[j] ) continue;
+        if ( j + 1 < M && power[j+1] > power[j] ) continue;
+
+        // Insert into the sorted list
+        size_t pos = n;
+        while ( pos > 0 && power[idx[pos-1]] < power[j] ) {
+            if ( pos < K ) idx[pos] = idx[pos-1];
+            pos--;
+        }
+        if ( pos < K ) {
+            idx[pos] = j;
+            if ( n < K ) n++;
+        }
+    }
+    return n;
+}
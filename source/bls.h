@@ -0,0 +1,6 @@
+void blsspec(double time[], double flux[], double weight[], double freq[],\
+             size_t N, size_t M, int nbins, double qmin, double qmax,\
+             double power[], double depth[], double q[], double phase[],\
+             double snr[], int useweight);
+
+size_t bls_peaks(double power[], size_t M, size_t K, size_t idx[]);
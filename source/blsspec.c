@@ -0,0 +1,244 @@
+/*  ~~~ Time Series Analysis -- Box Least Squares Transit Search ~~~
+ *
+ * Usage:
+ * blsspec.x [options] sampling inputfile outputfile
+ *
+ * Sampling: -f {auto | low high rate | list file | around file width rate |
+ *               log low high number}
+ *   auto: Trial frequencies from 1/(length of the series) to a period of
+ *         half a day, in steps which shift the phase of the last point by
+ *         at most one bin (1 / (bins * length of the series)).
+ *   low high rate: Values for sampling in microHz (e.g. "-f 1 50 0.001", to
+ *                  sample from 1 to 50 microHz in steps of 0.001 microHz).
+ *   list file, around file width rate, log low high number: As powerspec.x
+ *                  (frequencies listed in a file, windows around them, or
+ *                  a logarithmic grid).
+ *
+ * The output file contains the trial frequency, the power (reduction of the
+ * weighted variance of the data by the best box-shaped dip), its depth and
+ * signal-to-noise ratio. The best peaks are written to "outputfile.peaks":
+ * frequency (microHz), period (days), power, depth, duration (fraction of
+ * the period), phase of the middle of the transit (frequency * time, with
+ * the time in seconds) and signal-to-noise ratio. The SNR is the depth over
+ * sigma * sqrt(1/n_in + 1/n_out), with the scatter sigma of the data and the
+ * number of points in and out of the transit.
+ *
+ * Options:
+ *  -w: Use weights -- requires an extra column in the input file containing
+ *      weight per data point.
+ *  -wscatter number [column], -wsigma: Weights from the scatter in a moving
+ *         window, or from uncertainties in the input file (see powerspec.c).
+ *  -q: Quiet-mode. No output to console.
+ *  -t{sec|day|ms}: Unit of input file (seconds [default], days, megaseconds).
+ *  -noprep: Ignored (the weighted mean is always removed).
+ *  -fast: Fast-mode. Disable the automatic sampling. Activates quiet-mode.
+ *  -bins number: Number of phase bins (default 200). The durations are
+ *                multiples of one bin.
+ *  -duration qmin qmax: Shortest and longest duration of the transit as a
+ *                       fraction of the period (default 0.01 0.1).
+ *  -peaks number: Number of peaks in "outputfile.peaks" (default 5).
+ *
+ * Note:
+ * Using multi-threading with OpenMP. Set number of threads used by the shell
+ * variable "OMP_NUM_THREADS". The trial frequencies are split among the
+ * threads; for every frequency the data is folded into the phase bins in one
+ * pass (no sorting), and all durations are scanned using prefix sums of the
+ * bins.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "fileio.h"
+#include "arrlib.h"
+#include "grid.h"
+#include "bls.h"
+
+
+int main(int argc, char *argv[])
+{
+    /* Important definitions */
+    // Lengths
+    size_t N = 0;  // Length of time series
+    size_t M = 0;  // Length of sampling vector (number of frequencies)
+
+    // Filenames
+    char inname[100];
+    char outname[100];
+    char peakname[120];
+
+    // Sampling
+    double low, high, rate;
+    int freqmode = 0;
+    char listname[100];
+    size_t nlist = 0;
+
+    // Options
+    int quiet = 0;
+    int unit = 1;
+    int prep = 1;
+    int autosamp = 0;
+    int fast = 0;
+    int useweight = 0;
+    int wmode = 0;
+    int wlen = 0;
+    int Nclean = 0;
+    int filter = 0;
+    int nbins = 200;
+    double qmin = 0.01;
+    double qmax = 0.1;
+    int npeaks = 5;
+
+
+    /* Process command line arguments and return line count of the input file */
+    N = cmdarg(argc, argv, inname, outname, &quiet, &unit, &prep, &low, &high,\
+               &rate, &autosamp, &fast, &useweight, NULL, NULL, NULL,\
+               &Nclean, &filter, NULL, NULL, NULL, NULL, NULL, NULL, NULL,\
+               NULL, NULL, NULL, &freqmode, listname, &nbins,\
+               NULL, &qmin, &qmax, &npeaks, NULL, NULL, &wmode, &wlen);
+    if ( nbins < 2 ) nbins = 2;
+    if ( npeaks < 1 ) npeaks = 1;
+    if ( qmin <= 0 || qmax < qmin || qmax >= 1 ) {
+        fprintf(stderr, "Wrong durations of the transit! Quitting!\n");
+        exit(1);
+    }
+    snprintf(peakname, sizeof(peakname), "%s.peaks", outname);
+
+    // Pretty print
+    if ( quiet == 0 || fast == 1 ){
+        if ( useweight != 0 )
+            printf("\nBox least squares (weighted) of \"%s\" ...\n", inname);
+        else
+            printf("\nBox least squares of \"%s\" ...\n", inname);
+    }
+
+
+    /* Read data (and weights) from the input file */
+    if ( quiet == 0 ) printf(" - Reading input\n");
+    double* time = malloc(N * sizeof(double));
+    double* flux = malloc(N * sizeof(double));
+    double* weight = malloc(N * sizeof(double));
+    readcols(inname, time, flux, weight, N, useweight, wmode, wlen,\
+             unit, quiet);
+
+    // Do if fast-mode is not activated
+    if ( fast == 0 ) {
+        // Suggested sampling (one bin of phase over the series)
+        double span = time[N-1] - time[0];
+        double minsamp = 1.0e6 / (nbins * span);
+
+        // Display info?
+        if ( quiet == 0 ){
+            printf(" -- INFO: Length of time series = %li\n", N);
+            printf(" -- INFO: Suggested minimum sampling = %.5lf microHz\n",\
+                   minsamp);
+        }
+
+        // Apply automatic sampling?
+        if ( autosamp != 0 ) {
+            low = 1.0e6 / span;
+            high = 1.0e6 / 43200.0;
+            rate = minsamp;
+        }
+    }
+
+
+    /* Trial frequencies */
+    double* freq = freqgrid(freqmode, listname, low, high, rate, 0, &M,\
+                            &nlist);
+    double* power = malloc(M * sizeof(double));
+    double* depth = malloc(M * sizeof(double));
+    double* q = malloc(M * sizeof(double));
+    double* phase = malloc(M * sizeof(double));
+    double* snr = malloc(M * sizeof(double));
+
+    // Display info
+    if ( quiet == 0 ){
+        printf(" - Searching for transits\n");
+        if ( freqmode == 1 )
+            printf(" -- INFO: Sampling: The frequencies listed in \"%s\"\n",\
+                   listname);
+        else if ( freqmode == 2 )
+            printf(" -- INFO: Sampling (in microHz): +/- %.2lf around the"\
+                   " %li frequencies listed in \"%s\" in steps of %.5lf\n",\
+                   low, nlist, listname, rate);
+        else if ( freqmode == 3 )
+            printf(" -- INFO: Sampling (in microHz): %.4lf to %.4lf,"\
+                   " logarithmic\n", low, high);
+        else
+            printf(" -- INFO: Sampling (in microHz): %.4lf to %.4lf in"\
+                   " steps of %.5lf\n", low, high, rate);
+        printf(" -- INFO: Number of trial frequencies = %li\n", M);
+        printf(" -- INFO: %i phase bins, durations %.4lf to %.4lf of the"\
+               " period\n", nbins, qmin, qmax);
+    }
+
+
+    /* Box search */
+    double start = omp_get_wtime();
+    blsspec(time, flux, weight, freq, N, M, nbins, qmin, qmax, power, depth,\
+            q, phase, snr, useweight);
+    if ( quiet == 0 )
+        printf(" -- INFO: %.3lg trial periods per second\n",\
+               M / (omp_get_wtime() - start));
+
+    // The best peaks
+    size_t* idx = malloc(npeaks * sizeof(size_t));
+    size_t K = bls_peaks(power, M, npeaks, idx);
+    if ( quiet == 0 ) {
+        printf("\n %4s %13s %12s %12s %10s %8s\n", "Peak", "Frequency",\
+               "Period [d]", "Depth", "Duration", "SNR");
+        for (size_t k = 0; k < K; ++k) {
+            size_t j = idx[k];
+            printf(" %4li %13.5lf %12.6lf %12.5lg %10.4lf %8.2lf\n", k+1,\
+                   freq[j], 1e6 / freq[j] / 86400.0, depth[j], q[j], snr[j]);
+        }
+        printf("\n");
+    }
+
+
+    /* Write data to file */
+    if ( quiet == 0 ) printf(" - Saving to files \"%s\" and \"%s\"\n",\
+                             outname, peakname);
+    FILE* outfile = fopen(outname, "w");
+    if ( outfile != NULL ) {
+        for (size_t j = 0; j < M; ++j) {
+            fprintf(outfile, "%15.9e %18.9e %18.9e %12.5e\n", freq[j],\
+                    power[j], depth[j], snr[j]);
+        }
+        fclose(outfile);
+    }
+    FILE* peakfile = fopen(peakname, "w");
+    if ( peakfile != NULL ) {
+        fprintf(peakfile, "# %13s %14s %16s %16s %10s %10s %10s\n",\
+                "Frequency", "Period [d]", "Power", "Depth", "Duration",\
+                "Phase", "SNR");
+        for (size_t k = 0; k < K; ++k) {
+            size_t j = idx[k];
+            fprintf(peakfile, "%15.9e %14.8e %16.9e %16.9e %10.6lf %10.6lf"\
+                    " %10.4lf\n", freq[j], 1e6 / freq[j] / 86400.0,\
+                    power[j], depth[j], q[j], phase[j], snr[j]);
+        }
+        fclose(peakfile);
+    }
+
+
+    /* Free data */
+    free(time);
+    free(flux);
+    free(weight);
+    free(freq);
+    free(power);
+    free(depth);
+    free(q);
+    free(phase);
+    free(snr);
+    free(idx);
+
+
+    /* Done! */
+    if ( quiet == 0 || fast ==1 ) printf("Done!\n\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Checkpoints of long runs (completed frequencies, CLEANed peaks)
+ *
+ * A checkpoint holds the results done so far, and a key (hash) of the
+ * input data and the parameters of the run. A restarted run with the same
+ * key continues after the stored results; any other checkpoint is ignored.
+ * The file is written to a temporary file, synced and renamed, so a run
+ * killed while writing always leaves the previous complete checkpoint.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "wincache.h"
+
+// Identifier of the file format
+#define MAGIC "TSACKP01"
+
+// Number of parts of the frequencies (between the checkpoints), and the min.
+// number of frequencies per part
+#define CKPTPARTS 64
+#define CKPTMIN 64
+
+
+/* Key of a checkpoint: Hash of the data and the parameters of the run
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `flux`     : Array of data (as used in the calculation).
+ *  - `weight`   : Array of statistical weights (only used if useweight != 0).
+ *  - `N`        : Length of the time series
+ *  - `param`    : Array of parameters of the run (sampling, engine etc.)
+ *  - `P`        : Length of the parameter array
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ */
+uint64_t ckpt_key(double time[], double flux[], double weight[], size_t N,\
+                  double param[], size_t P, int useweight)
+{
+    uint64_t hash = wincache_key(time, weight, N, param, P, useweight);
+    return hashbytes(hash, flux, N * sizeof(double));
+}
+
+
+/* Number of frequencies to calculate between the checkpoints */
+size_t ckpt_part(size_t M)
+{
+    size_t part = (M + CKPTPARTS - 1) / CKPTPARTS;
+    return ( part < CKPTMIN ) ? CKPTMIN : part;
+}
+
+
+/* Read a checkpoint
+ *  --> Returns the number of values read into `data` (at most Mmax). 0 if
+ *      there is no checkpoint, or it belongs to another run.
+ */
+size_t ckpt_load(char *fname, uint64_t key, double data[], size_t Mmax)
+{
+    char magic[8];
+    uint64_t filekey, done;
+    size_t got = 0;
+
+    FILE* infile = fopen(fname, "rb");
+    if ( infile == NULL ) return 0;
+
+    // Check the header before reading the data
+    if ( fread(magic, 1, 8, infile) == 8 && memcmp(magic, MAGIC, 8) == 0 &&\
+         fread(&filekey, sizeof(filekey), 1, infile) == 1 && filekey == key &&\
+         fread(&done, sizeof(done), 1, infile) == 1 ) {
+        if ( done > Mmax ) done = Mmax;
+        if ( fread(data, sizeof(double), done, infile) == done ) got = done;
+    }
+    fclose(infile);
+
+    return got;
+}
+
+
+/* Write a checkpoint with the first `done` values of data (atomically) */
+void ckpt_save(char *fname, uint64_t key, double data[], size_t done)
+{
+    char tmpname[600];
+    uint64_t filedone = done;
+    int success = 0;
+
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp%li", fname, (long) getpid());
+    FILE* outfile = fopen(tmpname, "wb");
+    if ( outfile == NULL ) {
+        fprintf(stderr, "Warning: Cannot write checkpoint \"%s\"\n", tmpname);
+        return;
+    }
+    if ( fwrite(MAGIC, 1, 8, outfile) == 8 &&\
+         fwrite(&key, sizeof(key), 1, outfile) == 1 &&\
+         fwrite(&filedone, sizeof(filedone), 1, outfile) == 1 &&\
+         fwrite(data, sizeof(double), done, outfile) == done )
+        success = 1;
+
+    // On disk before it replaces the old checkpoint
+    if ( fflush(outfile) != 0 || fsync(fileno(outfile)) != 0 ) success = 0;
+    if ( fclose(outfile) != 0 ) success = 0;
+
+    // Move into place (or clean up)
+    if ( success == 0 || rename(tmpname, fname) != 0 ) remove(tmpname);
+}
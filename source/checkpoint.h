@@ -0,0 +1,8 @@
+uint64_t ckpt_key(double time[], double flux[], double weight[], size_t N,\
+                  double param[], size_t P, int useweight);
+
+size_t ckpt_part(size_t M);
+
+size_t ckpt_load(char *fname, uint64_t key, double data[], size_t Mmax);
+
+void ckpt_save(char *fname, uint64_t key, double data[], size_t done);
@@ -0,0 +1,151 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Sums over the time series in fixed chunks with a deterministic reduction
+ *
+ * The sums for a frequency are always formed in the same order: the series
+ * is split in chunks of fixed length, each chunk is summed by a kernel, and
+ * the chunk sums are combined pairwise (cascade) in a fixed order. Hence
+ * the sums are identical whether the frequencies are distributed over the
+ * threads, or the chunks of a few frequencies are -- and independent of the
+ * number of threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "chunk.h"
+
+// Points per chunk and the max. number of levels of the cascade
+#define CHUNKLEN 4096
+#define CHUNKLEVELS 64
+
+// Use chunks as parallel work if there are less than this many frequencies
+// per thread
+#define CHUNKFREQ 8
+
+void cascade_add(double stack[], int level[], int *depth, double part[],\
+                 size_t K);
+
+void cascade_result(double stack[], int *depth, size_t K, double sums[]);
+
+
+/* Should the time axis be split among the threads for M frequencies? */
+int chunk_usetime(size_t N, size_t M)
+{
+    size_t threads = omp_get_max_threads();
+    return ( threads > 1 && M < CHUNKFREQ * threads && N > CHUNKLEN );
+}
+
+
+/* Calculate K sums over the series at one frequency (serial)
+ *
+ * Arguments:
+ *  - `kernel`: Function summing the terms lo ... hi-1 at frequency ny
+ *  - `data`  : Data passed on to the kernel
+ *  - `N`     : Length of the time series
+ *  - `ny`    : Angular frequency
+ *  - `K`     : Number of sums (at most CHUNKSUMS)
+ *  - `sums`  : OUTPUT -- Array with the K sums
+ */
+void chunk_sums(chunkkernel kernel, void *data, size_t N, double ny,\
+                size_t K, double sums[])
+{
+    double stack[CHUNKLEVELS * CHUNKSUMS];
+    int level[CHUNKLEVELS];
+    int depth = 0;
+    double part[CHUNKSUMS];
+
+    for (size_t lo = 0; lo < N; lo += CHUNKLEN) {
+        size_t hi = (N - lo < CHUNKLEN) ? N : lo + CHUNKLEN;
+        kernel(lo, hi, ny, data, part);
+        cascade_add(stack, level, &depth, part, K);
+    }
+    cascade_result(stack, &depth, K, sums);
+}
+
+
+/* Calculate K sums over the series at M frequencies, with the chunks of the
+ * series distributed over the threads. The result is identical to calling
+ * chunk_sums for each frequency.
+ *
+ * Arguments:
+ *  - `kernel`: Function summing the terms lo ... hi-1 at frequency ny
+ *  - `data`  : Data passed on to the kernel
+ *  - `N`     : Length of the time series
+ *  - `ny`    : Array of angular frequencies
+ *  - `M`     : Number of frequencies
+ *  - `K`     : Number of sums (at most CHUNKSUMS)
+ *  - `sums`  : OUTPUT -- Array with the M*K sums (frequency by frequency)
+ */
+void chunk_sums_par(chunkkernel kernel, void *data, size_t N, double ny[],\
+                    size_t M, size_t K, double sums[])
+{
+    size_t Nchunk = (N + CHUNKLEN - 1) / CHUNKLEN;
+    double* part = malloc(Nchunk * M * K * sizeof(double));
+
+    // Sums of all chunks at all frequencies
+    #pragma omp parallel for default(shared) schedule(static) collapse(2)
+    for (size_t j = 0; j < Nchunk; ++j) {
+        for (size_t i = 0; i < M; ++i) {
+            size_t lo = j * CHUNKLEN;
+            size_t hi = (N - lo < CHUNKLEN) ? N : lo + CHUNKLEN;
+            kernel(lo, hi, ny[i], data, &part[(i*Nchunk + j) * K]);
+        }
+    }
+
+    // Fixed-order reduction for each frequency
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0; i < M; ++i) {
+        double stack[CHUNKLEVELS * CHUNKSUMS];
+        int level[CHUNKLEVELS];
+        int depth = 0;
+        for (size_t j = 0; j < Nchunk; ++j) {
+            cascade_add(stack, level, &depth, &part[(i*Nchunk + j) * K], K);
+        }
+        cascade_result(stack, &depth, K, &sums[i*K]);
+    }
+
+    free(part);
+}
+
+
+// Add the sums of the next chunk to the cascade. Partial sums of equal size
+// (level) are merged as soon as possible, left + right
+void cascade_add(double stack[], int level[], int *depth, double part[],\
+                 size_t K)
+{
+    int lev = 0;
+    double cur[CHUNKSUMS];
+    memcpy(cur, part, K * sizeof(double));
+
+    while ( *depth > 0 && level[*depth - 1] == lev ) {
+        (*depth)--;
+        for (size_t k = 0; k < K; ++k) {
+            cur[k] = stack[*depth * CHUNKSUMS + k] + cur[k];
+        }
+        lev++;
+    }
+    memcpy(&stack[*depth * CHUNKSUMS], cur, K * sizeof(double));
+    level[*depth] = lev;
+    (*depth)++;
+}
+
+
+// Combine the remaining partial sums of the cascade (from the right)
+void cascade_result(double stack[], int *depth, size_t K, double sums[])
+{
+    for (size_t k = 0; k < K; ++k) {
+        sums[k] = 0;
+    }
+    if ( *depth == 0 ) return;
+
+    memcpy(sums, &stack[(*depth - 1) * CHUNKSUMS], K * sizeof(double));
+    for (int d = *depth - 2; d >= 0; --d) {
+        for (size_t k = 0; k < K; ++k) {
+            sums[k] = stack[d * CHUNKSUMS + k] + sums[k];
+        }
+    }
+    *depth = 0;
+}
@@ -0,0 +1,12 @@
+#define CHUNKSUMS 6
+
+typedef void (*chunkkernel)(size_t lo, size_t hi, double ny, void *data,\
+                            double sums[]);
+
+int chunk_usetime(size_t N, size_t M);
+
+void chunk_sums(chunkkernel kernel, void *data, size_t N, double ny,\
+                size_t K, double sums[]);
+
+void chunk_sums_par(chunkkernel kernel, void *data, size_t N, double ny[],\
+                    size_t M, size_t K, double sums[]);
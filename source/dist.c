@@ -0,0 +1,169 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Distribution of the frequencies over several processes (MPI)
+ *
+ * The frequency grid is split in contiguous slices, one per process, and
+ * each process calculates its slice with OpenMP. The time series is read by
+ * the first process (rank 0) and broadcasted once; the results are gathered
+ * on rank 0, which writes the output.
+ *
+ * Only compiled with MPI when USEMPI is defined (see "make mpi" in the
+ * Makefile). Otherwise all routines reduce to a single process holding all
+ * frequencies, so the programs can call them unconditionally.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef USEMPI
+#include <mpi.h>
+#endif
+
+#include "dist.h"
+
+// Max. number of elements sent in one message (counts in MPI are int)
+#define DISTMSG (1 << 28)
+
+// Rank of this process and the number of processes
+static int rank = 0;
+static int size = 1;
+
+
+/* Initialise -- returns the rank of this process (0 = the root) */
+int dist_init(int *argc, char ***argv, int *nproc)
+{
+#ifdef USEMPI
+    // The programs use OpenMP inside each process, but only the main thread
+    // communicates
+    int provided;
+    MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+#endif
+    if ( nproc != NULL ) *nproc = size;
+    return rank;
+}
+
+
+/* Finalise */
+void dist_finalize(void)
+{
+#ifdef USEMPI
+    MPI_Finalize();
+#endif
+}
+
+
+/* Slice of M frequencies of process `r`: indices lo ... lo+cnt-1 */
+void dist_slice(size_t M, int r, size_t *lo, size_t *cnt)
+{
+    size_t base = M / size;
+    size_t rest = M % size;
+
+    // The first `rest` processes get one frequency more
+    *lo = r * base + ( (size_t) r < rest ? r : rest );
+    *cnt = base + ( (size_t) r < rest ? 1 : 0 );
+}
+
+
+/* Slice of the frequencies for this process
+ *
+ * Arguments:
+ *  - `M`      : Total number of frequencies
+ *  - `overlap`: Number of frequencies to include from each neighbouring
+ *               slice (e.g. for refining peaks at the edge of a slice)
+ *  - `lo`     : OUTPUT -- Index of the first frequency of the slice
+ *  - `cnt`    : OUTPUT -- Number of frequencies in the slice (may be 0 if
+ *               there are more processes than frequencies)
+ */
+void dist_range(size_t M, size_t overlap, size_t *lo, size_t *cnt)
+{
+    size_t hi;
+    dist_slice(M, rank, lo, cnt);
+    if ( *cnt == 0 ) return;
+
+    // Extend with the overlap (within the grid)
+    hi = *lo + *cnt + overlap;
+    if ( hi > M ) hi = M;
+    *lo = ( *lo > overlap ) ? *lo - overlap : 0;
+    *cnt = hi - *lo;
+}
+
+
+/* Broadcast the array x of length N from the root to all processes */
+void dist_bcast(double x[], size_t N)
+{
+#ifdef USEMPI
+    for (size_t i = 0; i < N; i += DISTMSG) {
+        size_t n = ( N - i < DISTMSG ) ? N - i : DISTMSG;
+        MPI_Bcast(&x[i], (int) n, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
+#endif
+}
+
+
+/* Gather the slices of x (length M, no overlap) on the root (IN-PLACE)
+ *  --> Each process has calculated its slice (see dist_range) in x
+ */
+void dist_gather(double x[], size_t M)
+{
+#ifdef USEMPI
+    if ( size == 1 ) return;
+
+    // Counts and displacements of all processes
+    int* counts = malloc(size * sizeof(int));
+    int* displs = malloc(size * sizeof(int));
+    size_t lo, cnt;
+    for (int r = 0; r < size; ++r) {
+        dist_slice(M, r, &lo, &cnt);
+        counts[r] = (int) cnt;
+        displs[r] = (int) lo;
+    }
+
+    // The root already has its slice in place
+    if ( rank == 0 )
+        MPI_Gatherv(MPI_IN_PLACE, 0, MPI_DOUBLE, x, counts, displs,\
+                    MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    else
+        MPI_Gatherv(&x[displs[rank]], counts[rank], MPI_DOUBLE, NULL, NULL,\
+                    NULL, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    free(counts);
+    free(displs);
+#endif
+}
+
+
+/* Global maximum of p over all processes
+ *  --> Returns the rank with the maximum (the lowest rank for ties)
+ *
+ * The K values in `val` belonging to the maximum are broadcasted from the
+ * process holding it, so all processes continue with the same values.
+ */
+int dist_argmax(double p, double val[], int K)
+{
+#ifdef USEMPI
+    if ( size == 1 ) return 0;
+
+    struct { double p; int rank; } local, global;
+    local.p = p;
+    local.rank = rank;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE_INT, MPI_MAXLOC,\
+                  MPI_COMM_WORLD);
+    MPI_Bcast(val, K, MPI_DOUBLE, global.rank, MPI_COMM_WORLD);
+    return global.rank;
+#else
+    return 0;
+#endif
+}
+
+
+/* Element-wise maximum of x over all processes (in place, on all) */
+void dist_max(double x[], size_t K)
+{
+#ifdef USEMPI
+    if ( size == 1 ) return;
+    MPI_Allreduce(MPI_IN_PLACE, x, (int) K, MPI_DOUBLE, MPI_MAX,\
+                  MPI_COMM_WORLD);
+#endif
+}
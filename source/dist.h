@@ -0,0 +1,15 @@
+int dist_init(int *argc, char ***argv, int *nproc);
+
+void dist_finalize(void);
+
+void dist_slice(size_t M, int r, size_t *lo, size_t *cnt);
+
+void dist_range(size_t M, size_t overlap, size_t *lo, size_t *cnt);
+
+void dist_bcast(double x[], size_t N);
+
+void dist_gather(double x[], size_t M);
+
+int dist_argmax(double p, double val[], int K);
+
+void dist_max(double x[], size_t K);
@@ -0,0 +1,262 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * False-alarm probabilities from randomised realisations of the data
+ *
+ * The flux is shuffled among the times, or replaced by Gaussian noise with
+ * the same scatter, R times, and the power spectrum of every realisation is
+ * compared to the spectrum of the data. Only the sums s and c depend on the
+ * flux; the design sums cc and sc are calculated once per frequency. The
+ * realisations are handled in batches which share each evaluation of
+ * sin/cos: for every point and frequency, the sin/cos terms are applied to
+ * all realisations of the batch at once. The batches are kept within
+ * FAMEMORY bytes (fewer realisations per batch for long series).
+ *
+ * The realisations only depend on the seed and their number (not on the
+ * batches or the threads), so the results are reproducible.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <omp.h>
+
+
+#define PI2 6.28318530717958647692528676655900576839433879875
+#define PI2micro 6.28318530717958647692528676655900576839433879875e-6
+
+// Max. number of realisations per batch (sharing the sin/cos) and max.
+// memory of a batch (bytes)
+#define FABATCH 64
+#define FAMEMORY (128 * 1024 * 1024)
+
+// Seed of the random numbers
+#define FASEED 20161018ULL
+
+uint64_t splitmix(uint64_t *state);
+
+double uniform(uint64_t *state);
+
+void realisation(double flux[], double weight[], size_t N, size_t r,\
+                 int mode, int useweight, double sigma, double x[],\
+                 size_t stride);
+
+void fasums(double time[], double X[], double weight[], size_t N, size_t B,\
+            double ny, int useweight, int design, double s[], double c[],\
+            double *cc, double *sc);
+
+
+/* False-alarm probabilities of a power spectrum
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `flux`     : Array of data (with the mean subtracted).
+ *  - `weight`   : Array of statistical weights.
+ *  - `freq`     : Array of cyclic frequencies to sample.
+ *  - `N`        : Length of the time series
+ *  - `M`        : Length of the sampling vector
+ *  - `R`        : Number of randomised realisations
+ *  - `mode`     : 1 = shuffle the flux, 2 = Gaussian noise with the same
+ *                 scatter (with weights: the scatter scales as 1/sqrt(weight))
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ *  - `power`    : OUTPUT -- Array (M) with the power spectrum of the data
+ *  - `fap`      : OUTPUT -- Array (M) with the false-alarm probability per
+ *                 frequency: (1 + realisations with at least the power of the
+ *                 data) / (R + 1)
+ *  - `maxpow`   : OUTPUT -- Array (R) with the max. power (over all sampled
+ *                 frequencies) of every realisation
+ */
+void falsealarm(double time[], double flux[], double weight[], double freq[],\
+                size_t N, size_t M, size_t R, int mode, int useweight,\
+                double power[], double fap[], double maxpow[])
+{
+    // Sum of the weights and the scatter of the data
+    double wsum = 0;
+    double sigma = 0;
+    for (size_t i = 0; i < N; ++i) {
+        double w = ( useweight != 0 ) ? weight[i] : 1;
+        wsum += w;
+        sigma += w * flux[i] * flux[i];
+    }
+    sigma = sqrt(sigma / N);
+
+    // Design sums (once per frequency) and counts of the exceedances
+    double* cc = malloc(M * sizeof(double));
+    double* sc = malloc(M * sizeof(double));
+    size_t* count = calloc(M, sizeof(size_t));
+    for (size_t r = 0; r < R; ++r) {
+        maxpow[r] = 0;
+    }
+
+    // Batches of realisations -- number 0 is the data itself
+    size_t B = ( R + 1 < FABATCH ) ? R + 1 : FABATCH;
+    size_t Bmem = FAMEMORY / (N * sizeof(double));
+    if ( Bmem < 1 ) Bmem = 1;
+    if ( B > Bmem ) B = Bmem;
+    double* X = malloc(N * B * sizeof(double));
+    for (size_t r0 = 0; r0 < R + 1; r0 += B) {
+        size_t Bn = ( R + 1 - r0 < B ) ? R + 1 - r0 : B;
+
+        // Realisations of the batch (point after point)
+        #pragma omp parallel for schedule(static)
+        for (size_t b = 0; b < Bn; ++b) {
+            if ( r0 + b == 0 ) {
+                for (size_t i = 0; i < N; ++i) {
+                    X[i*Bn] = flux[i];
+                }
+            }
+            else {
+                realisation(flux, weight, N, r0 + b, mode, useweight, sigma,\
+                            &X[b], Bn);
+            }
+        }
+
+        // Spectra of all realisations of the batch
+        #pragma omp parallel default(shared)
+        {
+            double s[FABATCH], c[FABATCH], maxlocal[FABATCH];
+            double D, ss, alpha, beta, p;
+            for (size_t b = 0; b < Bn; ++b) {
+                maxlocal[b] = 0;
+            }
+
+            #pragma omp for schedule(static)
+            for (size_t j = 0; j < M; ++j) {
+                fasums(time, X, weight, N, Bn, freq[j] * PI2micro, useweight,\
+                       ( r0 == 0 ), s, c, &cc[j], &sc[j]);
+                ss = wsum - cc[j];
+                D = ss*cc[j] - sc[j]*sc[j];
+                for (size_t b = 0; b < Bn; ++b) {
+                    alpha = (s[b] * cc[j] - c[b] * sc[j])/D;
+                    beta  = (c[b] * ss - s[b] * sc[j])/D;
+                    p = alpha*alpha + beta*beta;
+                    if ( r0 + b == 0 ) {
+                        power[j] = p;
+                        continue;
+                    }
+                    if ( p >= power[j] ) count[j]++;
+                    if ( p > maxlocal[b] ) maxlocal[b] = p;
+                }
+            }
+
+            // Max. of all threads (independent of the order)
+            #pragma omp critical
+            {
+                for (size_t b = 0; b < Bn; ++b) {
+                    if ( r0 + b == 0 ) continue;
+                    if ( maxlocal[b] > maxpow[r0 + b - 1] )
+                        maxpow[r0 + b - 1] = maxlocal[b];
+                }
+            }
+        }
+    }
+
+    // False-alarm probabilities
+    for (size_t j = 0; j < M; ++j) {
+        fap[j] = (1.0 + count[j]) / (R + 1.0);
+    }
+
+    free(X);
+    free(cc);
+    free(sc);
+    free(count);
+}
+
+
+// Sums s and c of B realisations (stored point after point in X), and the
+// design sums cc and sc if `design` != 0
+void fasums(double time[], double X[], double weight[], size_t N, size_t B,\
+            double ny, int useweight, int design, double s[], double c[],\
+            double *cc, double *sc)
+{
+    double sn, cn, w;
+    double sumcc = 0;
+    double sumsc = 0;
+    for (size_t b = 0; b < B; ++b) {
+        s[b] = 0;
+        c[b] = 0;
+    }
+
+    for (size_t i = 0; i < N; ++i) {
+        // One sin/cos for all realisations
+        sn = sin(ny * time[i]);
+        cn = cos(ny * time[i]);
+        w = ( useweight != 0 ) ? weight[i] : 1;
+        if ( design != 0 ) {
+            sumcc += w * cn * cn;
+            sumsc += w * sn * cn;
+        }
+
+        sn *= w;
+        cn *= w;
+        double* x = &X[i*B];
+        for (size_t b = 0; b < B; ++b) {
+            s[b] += x[b] * sn;
+            c[b] += x[b] * cn;
+        }
+    }
+
+    if ( design != 0 ) {
+        *cc = sumcc;
+        *sc = sumsc;
+    }
+}
+
+
+// Realisation number r (> 0) of the flux, written to x[i*stride]
+//  --> The mean is subtracted (as in the preparation of the data)
+void realisation(double flux[], double weight[], size_t N, size_t r,\
+                 int mode, int useweight, double sigma, double x[],\
+                 size_t stride)
+{
+    uint64_t state = FASEED ^ (0x9E3779B97F4A7C15ULL * r);
+    double mean = 0;
+
+    if ( mode == 1 ) {
+        // Shuffle (Fisher-Yates on the copy of the flux, in place)
+        for (size_t i = 0; i < N; ++i) {
+            x[i*stride] = flux[i];
+            mean += flux[i];
+        }
+        for (size_t i = N - 1; i > 0; --i) {
+            size_t k = splitmix(&state) % (i + 1);
+            double tmp = x[i*stride];
+            x[i*stride] = x[k*stride];
+            x[k*stride] = tmp;
+        }
+    }
+    else {
+        // Gaussian noise (Box-Muller)
+        double u1, u2, g;
+        for (size_t i = 0; i < N; ++i) {
+            u1 = uniform(&state);
+            u2 = uniform(&state);
+            g = sqrt(-2.0 * log(u1)) * cos(PI2 * u2);
+            if ( useweight != 0 ) g /= sqrt(weight[i]);
+            x[i*stride] = sigma * g;
+            mean += x[i*stride];
+        }
+    }
+
+    mean /= N;
+    for (size_t i = 0; i < N; ++i) {
+        x[i*stride] -= mean;
+    }
+}
+
+
+// Random numbers (SplitMix64)
+uint64_t splitmix(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+// Uniform random number in (0, 1]
+double uniform(uint64_t *state)
+{
+    return ((splitmix(state) >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+}
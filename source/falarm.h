@@ -0,0 +1,3 @@
+void falsealarm(double time[], double flux[], double weight[], double freq[],\
+                size_t N, size_t M, size_t R, int mode, int useweight,\
+                double power[], double fap[], double maxpow[]);
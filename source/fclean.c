@@ -14,23 +14,53 @@
  * Options:
  *  -w: Calculate weighted power spectrum -- requires an extra column in the
  *      input file containing weight per data point.
+ *  -wscatter number [column], -wsigma: Weights from the scatter in a moving
+ *         window, or from uncertainties in the input file (see powerspec.c).
  *  -q: Quiet-mode. No output to console.
  *  -t{sec|day|ms}: Unit of input file (seconds [default], days, megaseconds).
  *  -noprep: Do not subtract the mean of time series (for artificial data where
  *           the mean is 0).
+ *  -bin margin: Bin the time series before CLEANing (weighted means of
+ *               times and data, skipping gaps). The bins are as long as
+ *               possible while keeping the Nyquist frequency of the binned
+ *               series `margin` (> 1) times above the highest frequency. The
+ *               attenuation of the amplitude is reported. Without weights,
+ *               the number of points per bin is used as weights.
+ *  -checkpoint seconds: Save the frequencies found so far to the checkpoint
+ *         "outputfile.ckpt" at most every `seconds`. A restarted run with the
+ *         same input, sampling and output file removes the stored
+ *         frequencies again (giving the identical residual series) and
+ *         continues the CLEAN; the .cleanlog is rewritten in full. The
+ *         checkpoint is removed when the output is written.
+ *  -engine {auto|tune|direct|fft|zoom|float}: Engine for the search for the
+ *         peaks (see powerspec.c). With fft or zoom, the peak is searched in
+ *         the spectrum from the Fourier sums (if the sampling allows it);
+ *         with float, using single-precision sin/cos. The peaks are always
+ *         refined with the direct sums in double precision.
+ *         auto [default] and tune: Choose from the cost model (see
+ *         powerspec.c).
  *  -fast: Fast-mode. Disable Nyquist calculation (and hence automatic
  *         sampling range) for lower runtime. Activates quiet-mode. Use for
  *         benchmarking the pure I/O + algorithm.
+ *  -numa: Pin the threads and copy the series to every NUMA node used by
+ *         the threads (see powerspec.c).
  *
  * Note:
  * Using multi-threading with OpenMP. Set number of threads used by the shell
  * variable "OMP_NUM_THREADS".
  *
+ * MPI: "make mpi" builds fclean_mpi.x, which distributes the frequencies
+ * over several processes (each using OpenMP), e.g.
+ *   OMP_NUM_THREADS=4 mpirun -n 2 ./fclean_mpi.x -n 10 -f auto in.txt out.txt
+ * Each process finds the peak in its slice of the frequencies; the highest
+ * peak of all processes is CLEANed from the series on every process.
+ *
  * Author: Jakob Rørsted Mosumgaard
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 #include <omp.h>
@@ -38,6 +68,12 @@
 #include "fileio.h"
 #include "arrlib.h"
 #include "tsfourier.h"
+#include "preproc.h"
+#include "dist.h"
+#include "checkpoint.h"
+#include "tune.h"
+#include "series.h"
+#include "numa.h"
 
 #define PI2micro 6.28318530717958647692528676655900576839433879875e-6
 
@@ -64,14 +100,40 @@ int main(int argc, char *argv[])
     int autosamp = 0;
     int fast = 0;
     int useweight = 0;
+    int wmode = 0;
+    int wlen = 0;
     int Nclean = 1;
     int filter = 0;
+    int engine = 0;
+    double binmargin = 0;
+    double ckpt = -1;
+    int numa = 0;
+
+    // Processes (MPI)
+    int nproc = 1;
+    int rank = dist_init(&argc, &argv, &nproc);
+    size_t lo, cnt;
 
     
     /* Process command line arguments and return line count of the input file */
     N = cmdarg(argc, argv, inname, outname, &quiet, &unit, &prep, &low, &high,\
-               &rate, &autosamp, &fast, &useweight, NULL, NULL, &Nclean,\
-               &filter, NULL, NULL);
+               &rate, &autosamp, &fast, &useweight, NULL, NULL, NULL,\
+               &Nclean, &filter, NULL, NULL, NULL, &engine, &binmargin,\
+               NULL, &ckpt, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,\
+               NULL, NULL, &numa, NULL, &wmode, &wlen);
+    int measure = ( engine == 5 );  // -engine tune
+    if ( measure != 0 ) engine = 0;
+    fourier_setengine(engine);
+
+    // Name of the checkpoint
+    char ckptname[120];
+    snprintf(ckptname, sizeof(ckptname), "%s.ckpt", outname);
+
+    // Only the first process talks
+    if ( rank != 0 ) {
+        quiet = 1;
+        fast = 0;
+    }
 
     // Pretty print
     if ( quiet == 0 || fast == 1){
@@ -84,17 +146,26 @@ int main(int argc, char *argv[])
     }
 
     
+    // Pin the threads to the cores (before any data is placed)
+    if ( numa != 0 ) numa_pin(quiet);
+
+
     /* Read data (and weights) from the input file */
     if ( quiet == 0 ) printf(" - Reading input\n");
     double* time = malloc(N * sizeof(double));
     double* flux = malloc(N * sizeof(double));
     double* weight = malloc(N * sizeof(double));
-    readcols(inname, time, flux, weight, N, useweight, unit, quiet);
+    if ( rank == 0 )
+        readcols(inname, time, flux, weight, N, useweight, wmode, wlen,\
+                 unit, quiet);
+    dist_bcast(time, N);
+    dist_bcast(flux, N);
+    if ( useweight != 0 ) dist_bcast(weight, N);
 
     // Do if fast-mode is not activated
     if ( fast == 0 ) {
         // Calculate Nyquist frequency
-        double* dt = malloc(N-1 * sizeof(double));
+        double* dt = malloc((N-1) * sizeof(double));
         double nyquist;
         arr_diff(time, dt, N);
         nyquist = 1.0 / (2.0 * arr_median(dt, N-1)) * 1e6; // microHz !
@@ -132,6 +203,12 @@ int main(int argc, char *argv[])
     }
 
     
+    // Bin the time series? (The CLEANed series is at the binned times)
+    if ( binmargin > 0 ) {
+        N = binning(time, flux, weight, N, high, binmargin, &useweight, quiet);
+    }
+
+    
     /* Prepare for power spectrum */
     // Get length of sampling vector
     M = arr_util_getstep(low, high, rate);
@@ -142,6 +219,23 @@ int main(int argc, char *argv[])
     if ( quiet == 0 )
         printf(" -- INFO: Number of sampling frequencies = %li\n", M);
 
+    // Slice of the frequencies searched by this process (with one frequency
+    // of the neighbours, so peaks at the edges are refined as without MPI)
+    dist_range(M, 1, &lo, &cnt);
+    if ( quiet == 0 && nproc > 1 )
+        printf(" -- INFO: Frequencies distributed over %i processes\n", nproc);
+
+    // Choose the engine (on the first process)
+    if ( engine == 0 ) {
+        double choice = 0;
+        if ( rank == 0 && cnt > 1 )
+            choice = tune_engine(time, N, freq[lo], rate, cnt, measure,\
+                                 quiet);
+        dist_bcast(&choice, 1);
+        engine = choice;
+        fourier_setengine(engine);
+    }
+
     // Subtract the mean to avoid "zero-frequency" problems
     double fmean = 0;
     if ( prep != 0 ) {
@@ -159,24 +253,28 @@ int main(int argc, char *argv[])
     // Create log-file
     strcpy(logname, outname);
     strcat(logname, ".cleanlog");
-    FILE* logfile = fopen(logname, "w");
+    FILE* logfile = NULL;
+    if ( rank == 0 ) logfile = fopen(logname, "w");
 
     // Write header
-    fprintf(logfile, "# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~"\
-            "~~~~~~~~~~\n");
-    fprintf(logfile, "# Log of CLEAN on \"%s\"\n", inname);
-    fprintf(logfile, "# Interval: [%.2lf, %.2lf] microHz\n", low, high);
-    fprintf(logfile, "# Finding %i frequencies\n", Nclean);
-    fprintf(logfile, "# \n");
-    fprintf(logfile, "# %8s %11s %11s %12s %12s\n", "Number", "Frequency",\
-            "Power", "Alpha", "Beta");
-    fprintf(logfile, "# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~"\
-            "~~~~~~~~~~\n");
+    if ( rank == 0 ) {
+        fprintf(logfile, "# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~"\
+                "~~~~~~~~~~~~~~\n");
+        fprintf(logfile, "# Log of CLEAN on \"%s\"\n", inname);
+        fprintf(logfile, "# Interval: [%.2lf, %.2lf] microHz\n", low, high);
+        fprintf(logfile, "# Finding %i frequencies\n", Nclean);
+        fprintf(logfile, "# \n");
+        fprintf(logfile, "# %8s %11s %11s %12s %12s\n", "Number", "Frequency",\
+                "Power", "Alpha", "Beta");
+        fprintf(logfile, "# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~"\
+                "~~~~~~~~~~~~~~\n");
+    }
 
     
     /* Find and clean peaks */
     // Init variables
     double fmax, alpmax, betmax, powmax;
+    double peak[3];
     
     // Display info
     if ( quiet == 0 ) {
@@ -185,6 +283,31 @@ int main(int argc, char *argv[])
         printf("\n %9s %11s %11s\n", "Number", "Frequency", "Power");
     }
 
+    // Resume from a checkpoint of the same data and sampling?
+    //  --> The stored peaks are removed again in the same order, which gives
+    //      the identical residual series
+    int done = 0;
+    uint64_t key = 0;
+    double* peaks = malloc(3 * Nclean * sizeof(double));
+    if ( ckpt >= 0 ) {
+        double param[4] = {low, high, rate, engine};
+        key = ckpt_key(time, flux, weight, N, param, 4, useweight);
+        double ndone = 0;
+        if ( rank == 0 ) ndone = ckpt_load(ckptname, key, peaks, 3*Nclean) / 3;
+        dist_bcast(&ndone, 1);
+        done = ndone;
+        dist_bcast(peaks, 3*done);
+        if ( quiet == 0 && done > 0 )
+            printf(" -- INFO: Resuming from checkpoint with %i of %i"\
+                   " frequencies done\n", done, Nclean);
+    }
+    double lastckpt = omp_get_wtime();
+
+    // Prepare the series once (sum of weights and weight * data are updated
+    // with the residuals instead of being calculated in every search)
+    struct series* ser = series_prepare(time, flux, weight, N, useweight);
+    if ( numa != 0 ) series_replicate(ser);
+
     // Enter CLEAN-loop
     for (int i = 0; i < Nclean; ++i) {
         // Display progress
@@ -196,25 +319,60 @@ int main(int argc, char *argv[])
         betmax = 0;
         powmax = 0;
 
-        // Call with or without weights
-        fouriermax(time, flux, weight, freq, N, M, &fmax, &alpmax, &betmax,\
-                   useweight);
+        // Peak from the checkpoint
+        if ( i < done ) {
+            fmax = peaks[3*i];
+            alpmax = peaks[3*i + 1];
+            betmax = peaks[3*i + 2];
+        }
+        else {
+            // Call with or without weights (on the slice of this process)
+            if ( cnt > 1 ) {
+                fouriermax_series(ser, &freq[lo], cnt, &fmax, &alpmax,\
+                                  &betmax);
+                powmax = alpmax*alpmax + betmax*betmax;
+            }
+            else {
+                powmax = -1;
+            }
+
+            // Highest peak of all processes
+            peak[0] = fmax;
+            peak[1] = alpmax;
+            peak[2] = betmax;
+            dist_argmax(powmax, peak, 3);
+            fmax = peak[0];
+            alpmax = peak[1];
+            betmax = peak[2];
+            peaks[3*i] = fmax;
+            peaks[3*i + 1] = alpmax;
+            peaks[3*i + 2] = betmax;
+        }
 
         // Calculate the power and write to log
         powmax = alpmax*alpmax + betmax*betmax;
-        fprintf(logfile, " %6i %15.6lf %12.6lg %12.6lf %12.6lf\n", i+1, fmax,\
-                powmax, alpmax, betmax);
+        if ( rank == 0 ) {
+            fprintf(logfile, " %6i %15.6lf %12.6lg %12.6lf %12.6lf\n", i+1,\
+                    fmax, powmax, alpmax, betmax);
+            fflush(logfile);
+        }
         if ( quiet == 0) printf(" %15.6lf %12.6lg \n", fmax, powmax);
 
-        // Remove frequency from time series
-        for (int j = 0; j < N; ++j) {
-            flux[j] = flux[j] - alpmax * sin( PI2micro*fmax * time[j] ) - \
-                                betmax * cos( PI2micro*fmax * time[j] );
+        // Remove frequency from time series (and update weight * data)
+        series_subtract(ser, PI2micro*fmax, alpmax, betmax);
+
+        // Save the peaks found so far?
+        if ( ckpt >= 0 && rank == 0 && i >= done && i + 1 < Nclean &&\
+             omp_get_wtime() - lastckpt >= ckpt ) {
+            ckpt_save(ckptname, key, peaks, 3*(i+1));
+            lastckpt = omp_get_wtime();
         }
     }
 
     // Final touch
-    fclose(logfile);
+    memcpy(flux, ser->flux, N * sizeof(double));
+    series_free(ser);
+    if ( rank == 0 ) fclose(logfile);
     if ( quiet == 0 ) printf("\n");
 
     
@@ -225,7 +383,8 @@ int main(int argc, char *argv[])
     if ( prep != 0 ) arr_sca_add(flux, fmean, N);
 
     // Save to file
-    writecols3(outname, time, flux, weight, N, useweight, unit);
+    if ( rank == 0 )
+        writecols3(outname, time, flux, weight, N, useweight, unit);
 
     
     /* Free data */
@@ -233,9 +392,14 @@ int main(int argc, char *argv[])
     free(flux);
     free(weight);
     free(freq);
+    free(peaks);
+
+    // The checkpoint is no longer needed
+    if ( ckpt >= 0 && rank == 0 ) remove(ckptname);
 
 
     /* Done! */
+    dist_finalize();
     if ( quiet == 0 || fast ==1 ) printf("Done!\n\n");
     return 0; 
 }
@@ -0,0 +1,200 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Fast Fourier transforms and the chirp-z transform
+ *
+ * Used by the FFT-based engines for data on a regular cadence grid (with
+ * gaps). The chirp-z transform evaluates the Fourier sum of a gridded series
+ * at any equidistant set of frequencies -- not only the FFT frequencies.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <omp.h>
+
+#define PI2 6.28318530717958647692528676655900576839433879875
+#define PI2L 6.28318530717958647692528676655900576839433879875L
+
+// Minimum number of frequencies per block of the chirp-z transform
+#define CZTBLOCK 4096
+
+void fft_twiddle(double complex tw[], size_t P);
+
+void fft_run(double complex x[], double complex tw[], size_t P, int inverse);
+
+double complex phasor(double angle, double mult);
+
+
+/* Smallest power of two >= n */
+size_t fft_size(size_t n)
+{
+    size_t P = 1;
+    while ( P < n ) P <<= 1;
+    return P;
+}
+
+
+/* In-place complex FFT of length P (must be a power of two)
+ *  - `inverse` != 0 gives the (unnormalised) inverse transform
+ */
+void fft(double complex x[], size_t P, int inverse)
+{
+    double complex* tw = malloc(P/2 * sizeof(double complex));
+    fft_twiddle(tw, P);
+    fft_run(x, tw, P, inverse);
+    free(tw);
+}
+
+
+/* Size of the transforms of czt() for a series of length L and M
+ * frequencies (and the number of blocks of frequencies)
+ */
+size_t czt_size(size_t L, size_t M, size_t *Nblock)
+{
+    size_t B = L > CZTBLOCK ? L : CZTBLOCK;
+    if ( B > M ) B = M;
+    *Nblock = (M + B - 1) / B;
+    return fft_size(L + B - 1);
+}
+
+
+/* Chirp-z transform (Bluestein's algorithm)
+ *
+ * Calculates the sums
+ *     out[k] = sum_n x[n] * exp(i * (tha + k*dth) * n),   k = 0 ... M-1
+ * for a series x of length L. The angles are in radians per grid step. The
+ * frequencies are processed in blocks (in parallel), to keep the transforms
+ * at a size comparable to the series.
+ *
+ * Arguments:
+ *  - `x`  : Array (complex) with the series on the grid
+ *  - `L`  : Length of the series
+ *  - `tha`: Angle per step of the first frequency
+ *  - `dth`: Increment of the angle per step between frequencies
+ *  - `M`  : Number of frequencies
+ *  - `out`: OUTPUT -- Array (complex) with the sums
+ */
+void czt(double complex x[], size_t L, double tha, double dth, size_t M,\
+         double complex out[])
+{
+    // Block length and size of the transforms
+    size_t B = L > CZTBLOCK ? L : CZTBLOCK;
+    if ( B > M ) B = M;
+    size_t Nblock;
+    size_t P = czt_size(L, M, &Nblock);
+
+    // Twiddle factors and the transformed chirp filter (common to all blocks)
+    //  - filter[m + L-1] = exp(-i dth m^2 / 2)  for  m = -(L-1) ... B-1
+    double complex* tw = malloc(P/2 * sizeof(double complex));
+    double complex* filter = malloc(P * sizeof(double complex));
+    fft_twiddle(tw, P);
+    for (size_t j = 0; j < P; ++j) {
+        if ( j < L + B - 1 ) {
+            double m = (double) j - (double) (L - 1);
+            filter[j] = phasor(-0.5 * dth, m*m);
+        }
+        else {
+            filter[j] = 0;
+        }
+    }
+    fft_run(filter, tw, P, 0);
+
+    // Process blocks of frequencies
+    #pragma omp parallel default(shared)
+    {
+        double complex* work = malloc(P * sizeof(double complex));
+
+        #pragma omp for schedule(dynamic)
+        for (size_t blk = 0; blk < Nblock; ++blk) {
+            size_t k0 = blk * B;
+            size_t Mblk = (M - k0 < B) ? M - k0 : B;
+            double thb = tha + k0 * dth;
+
+            // Pre-multiply with the chirp (and the start frequency)
+            for (size_t n = 0; n < P; ++n) {
+                if ( n < L ) {
+                    double dn = (double) n;
+                    work[n] = x[n] * phasor(thb, dn) *\
+                              phasor(0.5 * dth, dn*dn);
+                }
+                else {
+                    work[n] = 0;
+                }
+            }
+
+            // Convolution with the chirp filter
+            fft_run(work, tw, P, 0);
+            for (size_t n = 0; n < P; ++n) {
+                work[n] *= filter[n];
+            }
+            fft_run(work, tw, P, 1);
+
+            // Post-multiply with the chirp and normalise
+            for (size_t k = 0; k < Mblk; ++k) {
+                double dk = (double) k;
+                out[k0 + k] = work[k + L-1] * phasor(0.5 * dth, dk*dk) / P;
+            }
+        }
+
+        free(work);
+    }
+
+    // Done
+    free(tw);
+    free(filter);
+}
+
+
+// exp(i * angle * mult) with the total angle reduced in extended precision
+//  --> The chirps have angles growing quadratically with the length
+double complex phasor(double angle, double mult)
+{
+    long double ang = fmodl((long double) angle * mult, PI2L);
+    double a = (double) ang;
+    return cos(a) + I * sin(a);
+}
+
+
+// Twiddle factors exp(-2 pi i k / P) for k < P/2
+void fft_twiddle(double complex tw[], size_t P)
+{
+    for (size_t k = 0; k < P/2; ++k) {
+        double a = PI2 * k / P;
+        tw[k] = cos(a) - I * sin(a);
+    }
+}
+
+
+// Iterative radix-2 FFT (decimation in time) using precomputed twiddles
+void fft_run(double complex x[], double complex tw[], size_t P, int inverse)
+{
+    double complex tmp, u, v, w;
+
+    // Bit reversal permutation
+    for (size_t i = 1, j = 0; i < P; ++i) {
+        size_t bit = P >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if ( i < j ) {
+            tmp = x[i];
+            x[i] = x[j];
+            x[j] = tmp;
+        }
+    }
+
+    // Butterflies
+    for (size_t len = 2; len <= P; len <<= 1) {
+        size_t half = len >> 1;
+        size_t step = P / len;
+        for (size_t i = 0; i < P; i += len) {
+            for (size_t k = 0; k < half; ++k) {
+                w = inverse ? conj(tw[k*step]) : tw[k*step];
+                u = x[i+k];
+                v = x[i+k+half] * w;
+                x[i+k] = u + v;
+                x[i+k+half] = u - v;
+            }
+        }
+    }
+}
@@ -0,0 +1,8 @@
+size_t fft_size(size_t n);
+
+void fft(double complex x[], size_t P, int inverse);
+
+size_t czt_size(size_t L, size_t M, size_t *Nblock);
+
+void czt(double complex x[], size_t L, double tha, double dth, size_t M,\
+         double complex out[]);
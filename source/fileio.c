@@ -9,13 +9,27 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Max. number of window frequencies
+#define WINMAX 64
+
+size_t countlines(char *fname);
+
+void cmdusage(char *prog, int kind);
+
+void movweight(FILE *infile, double x[], double y[], double z[], size_t N,\
+               int wmode, int wlen);
+
 
 /* Check command-line argument and count lines in given file */
 int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
            int *unit, int *prep, double *low, double *high, double *rate,\
            int *autosamp, int *fast, int *useweight, int *windowmode,\
-           double *winfreq, int *CLEAN, int *filter, double *fstart,\
-           double *fstop)
+           double winfreq[], size_t *nwin, int *CLEAN, int *filter,\
+           double *fstart, double *fstop, char bankname[], int *engine,\
+           double *binmargin, int *trig, double *ckpt, int *nreal,\
+           int *famode, int *harmonics, int *freqmode, char listname[],\
+           int *nbins, int *covers, double *qmin, double *qmax,\
+           int *npeaks, int *numa, int *pyramid, int *wmode, int *wlen)
 {
     // Internal
     int isamp = 0;
@@ -23,31 +37,13 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
     int iwin = 0;
     
     // Quit if wrong number of arguments is given!
-    if ( *CLEAN != 0 ){
-        if (argc < 7) {
-            fprintf(stderr, "usage: %s  [-w] [-q] [-t{sec|day|ms}]" \
-                    " [-noprep] -n number -f {low high factor}" \
-                    " input_file output_file\n", argv[0]);
-            exit(1);
-        }
-    }
-    else if ( *filter != 0 ) {
-        if (argc < 6) {
-            fprintf(stderr, "usage: %s  [-w] [-q] [-t{sec|day|ms}]" \
-                    " [-noprep] mode -f {auto | low high rate}" \
-                    " input_file output_file\n", argv[0]);
-            exit(1);
-        }
-        
-    }
-    else {
-        if (argc < 5) {
-            fprintf(stderr, "usage: %s  [-window f0] [-w] [-q] [-t{sec|day|ms}]" \
-                    " [-noprep] [-fast] -f {auto | low high rate | limit rate}" \
-                    " input_file output_file\n", argv[0]);
-            exit(1);
-        }
-    }
+    int kind = 0;
+    if ( *CLEAN != 0 ) kind = 1;
+    else if ( *filter != 0 ) kind = 2;
+    else if ( npeaks != NULL ) kind = 3;
+    else if ( covers != NULL ) kind = 4;
+    int minargs[5] = {5, 7, 6, 5, 5};
+    if ( argc < minargs[kind] ) cmdusage(argv[0], kind);
 
     // Loop through given arguments (skipping program name)
     for (int i = 1; i < argc; ++i) {
@@ -67,7 +63,7 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
             *unit = 3;
         }
         // Modify data
-        else if ( strcmp(argv[i], "-noprep" ) == 0 ) {
+        else if ( strcmp(argv[i], "-noprep" ) == 0 && prep != NULL ) {
             *prep = 0;
         }
         // Fast-mode
@@ -79,14 +75,132 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
         else if ( strcmp(argv[i], "-w" ) == 0 ) {
             *useweight = 1;
         }
+        // Weights from the scatter in a moving window (of the data or of the
+        // third column), or from the uncertainties in the third column
+        else if ( strcmp(argv[i], "-wscatter" ) == 0 && wmode != NULL ) {
+            *useweight = 1;
+            *wmode = 1;
+            i++;
+            *wlen = atoi(argv[i]);
+            if ( i+1 < argc && strcmp(argv[i+1], "column" ) == 0 ) {
+                *wmode = 2;
+                i++;
+            }
+        }
+        else if ( strcmp(argv[i], "-wsigma" ) == 0 && wmode != NULL ) {
+            *useweight = 1;
+            *wmode = 3;
+        }
         // Windowfunction-mode
-        else if ( strcmp(argv[i], "-window" ) == 0 ) {
+        else if ( strcmp(argv[i], "-window" ) == 0 && windowmode != NULL ) {
             *windowmode = 1;
             iwin = 1;
 
-            // Read frequency
+            // Read frequencies (comma-separated, at most WINMAX)
+            i++;
+            char* p = argv[i];
+            char* end;
+            *nwin = 0;
+            while ( *nwin < WINMAX ) {
+                winfreq[*nwin] = strtod(p, &end);
+                if ( end == p ) break;
+                (*nwin)++;
+                if ( *end != ',' ) break;
+                p = end + 1;
+            }
+            if ( *nwin == 0 ) {
+                fprintf(stderr, "No window frequency given! Quitting!\n");
+                exit(1);
+            }
+        }
+        // Binning of the time series
+        else if ( strcmp(argv[i], "-bin" ) == 0 && binmargin != NULL ) {
+            i++;
+            *binmargin = atof(argv[i]);
+            if ( *binmargin <= 1 ) {
+                fprintf(stderr, "The margin of the binning must be > 1!"\
+                        " Quitting!\n");
+                exit(1);
+            }
+        }
+        // Checkpoints (interval in seconds)
+        else if ( strcmp(argv[i], "-checkpoint" ) == 0 && ckpt != NULL ) {
+            i++;
+            *ckpt = atof(argv[i]);
+        }
+        // False-alarm probabilities (number of realisations and kind)
+        else if ( strcmp(argv[i], "-falarm" ) == 0 && nreal != NULL ) {
+            i++;
+            *nreal = atoi(argv[i]);
+            i++;
+            if ( strcmp(argv[i], "shuffle" ) == 0 ) *famode = 1;
+            else if ( strcmp(argv[i], "noise" ) == 0 ) *famode = 2;
+            else {
+                fprintf(stderr, "Unknown randomisation \"%s\"! Quitting!\n",\
+                        argv[i]);
+                exit(1);
+            }
+        }
+        // Number of harmonics fitted at every frequency
+        else if ( strcmp(argv[i], "-harmonics" ) == 0 && harmonics != NULL ) {
+            i++;
+            *harmonics = atoi(argv[i]);
+        }
+        // Number of phase bins and covers (period searches)
+        else if ( strcmp(argv[i], "-bins" ) == 0 && nbins != NULL ) {
+            i++;
+            *nbins = atoi(argv[i]);
+        }
+        else if ( strcmp(argv[i], "-covers" ) == 0 && covers != NULL ) {
+            i++;
+            *covers = atoi(argv[i]);
+        }
+        // Durations of the transits and number of peaks (box search)
+        else if ( strcmp(argv[i], "-duration" ) == 0 && qmin != NULL ) {
+            i++;
+            *qmin = atof(argv[i]);
+            i++;
+            *qmax = atof(argv[i]);
+        }
+        else if ( strcmp(argv[i], "-peaks" ) == 0 && npeaks != NULL ) {
             i++;
-            *winfreq = atof(argv[i]);
+            *npeaks = atoi(argv[i]);
+        }
+        // Placement of the threads and data on NUMA nodes
+        else if ( strcmp(argv[i], "-numa" ) == 0 && numa != NULL ) {
+            *numa = 1;
+        }
+        // Multi-resolution pyramid of the spectrum (pooling factor)
+        else if ( strcmp(argv[i], "-pyramid" ) == 0 && pyramid != NULL ) {
+            i++;
+            *pyramid = atoi(argv[i]);
+        }
+        // Accuracy of sin/cos
+        else if ( strcmp(argv[i], "-trig" ) == 0 && trig != NULL ) {
+            i++;
+            if ( strcmp(argv[i], "exact" ) == 0 ) *trig = 0;
+            else if ( strcmp(argv[i], "1e-10" ) == 0 ) *trig = 1;
+            else if ( strcmp(argv[i], "1e-6" ) == 0 ) *trig = 2;
+            else {
+                fprintf(stderr, "Unknown accuracy \"%s\"! Quitting!\n",\
+                        argv[i]);
+                exit(1);
+            }
+        }
+        // Engine for the calculation of the spectrum
+        else if ( strcmp(argv[i], "-engine" ) == 0 && engine != NULL ) {
+            i++;
+            if ( strcmp(argv[i], "auto" ) == 0 ) *engine = 0;
+            else if ( strcmp(argv[i], "direct" ) == 0 ) *engine = 1;
+            else if ( strcmp(argv[i], "fft" ) == 0 ) *engine = 2;
+            else if ( strcmp(argv[i], "zoom" ) == 0 ) *engine = 3;
+            else if ( strcmp(argv[i], "float" ) == 0 ) *engine = 4;
+            else if ( strcmp(argv[i], "tune" ) == 0 ) *engine = 5;
+            else {
+                fprintf(stderr, "Unknown engine \"%s\"! Quitting!\n",\
+                        argv[i]);
+                exit(1);
+            }
         }
         // Number of frequencies for CLEAN
         else if ( strcmp(argv[i], "-n" ) == 0 ) {
@@ -94,7 +208,7 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
             *CLEAN = atoi(argv[i]);
         }
         // Different modes for filtering
-        else if ( strcmp(argv[i], "-band" ) == 0 ) {
+        else if ( strcmp(argv[i], "-band" ) == 0 && fstart != NULL ) {
             *filter = 2;
 
             // Read frequencies
@@ -103,27 +217,64 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
             i++;
             *fstop = atof(argv[i]);
         }
-        else if ( strcmp(argv[i], "-low" ) == 0 ) {
+        else if ( strcmp(argv[i], "-low" ) == 0 && fstop != NULL ) {
             *filter = 3;
 
             // Read frequency
             i++;
             *fstop = atof(argv[i]);
         }
-        else if ( strcmp(argv[i], "-high" ) == 0 ) {
+        else if ( strcmp(argv[i], "-high" ) == 0 && fstop != NULL ) {
             *filter = 4;
 
             // Read frequency
             i++;
             *fstop = atof(argv[i]);
         }
+        else if ( strcmp(argv[i], "-bank" ) == 0 && bankname != NULL ) {
+            *filter = 5;
+
+            // Read name of file with the bands
+            i++;
+            strcpy(bankname, argv[i]);
+        }
         // Sampling
         else if ( strcmp(argv[i], "-f" ) == 0 ) {
             // Go to first option
             i++;
 
+            // Frequencies listed in a file
+            if ( strcmp(argv[i], "list") == 0 && freqmode != NULL ) {
+                isamp = 2;
+                *freqmode = 1;
+                i++;
+                strcpy(listname, argv[i]);
+            }
+            // Windows around the frequencies listed in a file
+            //  --> The half width is stored in 'low'
+            else if ( strcmp(argv[i], "around") == 0 && freqmode != NULL ) {
+                isamp = 2;
+                *freqmode = 2;
+                i++;
+                strcpy(listname, argv[i]);
+                i++;
+                *low = atof(argv[i]);
+                i++;
+                *rate = atof(argv[i]);
+            }
+            // Logarithmic grid (the number of frequencies is stored in 'rate')
+            else if ( strcmp(argv[i], "log") == 0 && freqmode != NULL ) {
+                isamp = 2;
+                *freqmode = 3;
+                i++;
+                *low = atof(argv[i]);
+                i++;
+                *high = atof(argv[i]);
+                i++;
+                *rate = atof(argv[i]);
+            }
             // Is window mode activated?
-            if ( iwin == 1 ) {
+            else if ( iwin == 1 ) {
                 isamp = 3;
 
                 // Read values and increment i
@@ -152,6 +303,11 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
                 break;
             }
         }
+        // Options unknown to (or not supported by) this program
+        else if ( argv[i][0] == '-' ) {
+            fprintf(stderr, "Unknown option \"%s\"!\n", argv[i]);
+            cmdusage(argv[0], kind);
+        }
         // Non-optional arguments (filenames)
         else {
             // Read input file
@@ -169,6 +325,13 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
         exit(1);
     }
 
+    // The frequencies of a window are always a linear grid
+    if ( freqmode != NULL && *freqmode != 0 && iwin == 1 ) {
+        fprintf(stderr, "Cannot combine -window and a frequency list or"\
+                " logarithmic grid! Quitting!\n");
+        exit(1);
+    }
+
     // Override options if fast-mode is activated
     if ( ifast == 1 ) {
         printf(" * Fast-mode activated. Going (almost) quiet * \n");
@@ -180,11 +343,72 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
     }
     
 
+    // Count lines in the input file (quits if it cannot be opened)
+    return countlines(inname);
+}
+
+
+// Print the usage of the program and quit (kind: 0 = power spectrum,
+// 1 = CLEAN, 2 = filter, 3 = box least squares, 4 = PDM)
+void cmdusage(char *prog, int kind)
+{
+    if ( kind == 1 ) {
+        fprintf(stderr, "usage: %s  [-w] [-wscatter number [column]]" \
+                " [-wsigma] [-q] [-t{sec|day|ms}]" \
+                " [-noprep] [-bin margin] [-engine name]" \
+                " [-checkpoint seconds] [-numa]" \
+                " -n number -f {low high factor}" \
+                " input_file output_file\n", prog);
+    }
+    else if ( kind == 2 ) {
+        fprintf(stderr, "usage: %s  [-w] [-wscatter number [column]]" \
+                " [-wsigma] [-q] [-t{sec|day|ms}]" \
+                " [-bin margin] [-engine name] [-trig accuracy]" \
+                " mode -f {auto | low high rate}" \
+                " input_file output_file\n", prog);
+    }
+    else if ( kind == 3 ) {
+        fprintf(stderr, "usage: %s  [-w] [-wscatter number [column]]" \
+                " [-wsigma] [-q] [-t{sec|day|ms}]" \
+                " [-noprep] [-fast] [-bins number]" \
+                " [-duration qmin qmax] [-peaks number]" \
+                " -f {auto | low high rate | list file |" \
+                " around file width rate | log low high number}" \
+                " input_file output_file\n", prog);
+    }
+    else if ( kind == 4 ) {
+        fprintf(stderr, "usage: %s  [-w] [-wscatter number [column]]" \
+                " [-wsigma] [-q] [-t{sec|day|ms}]" \
+                " [-noprep] [-fast] [-bins number] [-covers number]" \
+                " -f {auto | low high rate | list file |" \
+                " around file width rate | log low high number}" \
+                " input_file output_file\n", prog);
+    }
+    else {
+        fprintf(stderr, "usage: %s  [-window f0[,f1,...]]" \
+                " [-w] [-wscatter number [column]] [-wsigma]" \
+                " [-q] [-t{sec|day|ms}]" \
+                " [-noprep] [-fast] [-bin margin] [-engine name]" \
+                " [-trig accuracy] [-checkpoint seconds]" \
+                " [-falarm number {shuffle|noise}] [-harmonics K]" \
+                " [-numa] [-pyramid factor]" \
+                " -f {auto | low high rate | limit rate |" \
+                " list file | around file width rate |" \
+                " log low high number}" \
+                " input_file output_file\n", prog);
+    }
+    exit(1);
+}
+
+
+/* Count lines in given file -- quit if it cannot be opened */
+size_t countlines(char *fname)
+{
     // Read file and quit if it cannot be opened
     size_t ch, number_of_lines = 0;
-    FILE* tmpfile = fopen(inname, "r");
+    FILE* tmpfile = fopen(fname, "r");
     if ( tmpfile == 0 ) {
-        fprintf(stderr, "Could not open file:  %s \n", inname);
+        fprintf(stderr, "Could not open file:  %s \n", fname);
         exit(1);
     }
     
@@ -197,26 +421,47 @@ int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
     if(ch != '\n' && number_of_lines != 0)
         number_of_lines++;
 
-    // Close file and save number of actual lines
+    // Close file and save number of actual lines (none in an empty file)
     fclose(tmpfile);
+    if ( number_of_lines == 0 ) return 0;
     return number_of_lines - 1;
 }
 
 
-/* Read file with two or three columns of data */
+/* Read file with two or three columns of data
+ *
+ * With `wmode` != 0, the weights `z` are calculated while reading instead of
+ * read from the file (`three` is then ignored):
+ *  - 1: 1 / variance of the data in a moving window of the last `wlen`
+ *       points (two columns in the file)
+ *  - 2: As 1, but the variance of the third column (e.g. the residuals
+ *       of a high-pass filter) instead of the data
+ *  - 3: 1 / sigma^2 with the uncertainties sigma in the third column
+ * The variance of the window is updated in O(1) per point (see movweight).
+ */
 void readcols(char *fname, double x[], double y[], double z[], size_t N,\
-              int three, int unit, int quiet)
+              int three, int wmode, int wlen, int unit, int quiet)
 {
     // Read the file depending on the number of columns
     FILE* infile = fopen(fname, "r");
-    if ( three == 0 ) {
-        for (size_t i = 0; i < N+1; ++i) {
+    if ( wmode != 0 ) {
+        if ( quiet == 0 ) {
+            if ( wmode == 3 )
+                printf(" -- INFO: Using weights from the uncertainties\n");
+            else
+                printf(" -- INFO: Using weights from the scatter in a moving"\
+                       " window of %i points\n", ( wlen < 2 ) ? 2 : wlen);
+        }
+        movweight(infile, x, y, z, N, wmode, wlen);
+    }
+    else if ( three == 0 ) {
+        for (size_t i = 0; i < N; ++i) {
             if ( fscanf(infile ,"%lf%lf", &x[i], &y[i] ) != 2) break;
         }
     }
     else {
         if ( quiet == 0 ) printf(" -- INFO: Using weights\n");
-        for (size_t i = 0; i < N+1; ++i) {
+        for (size_t i = 0; i < N; ++i) {
             if ( fscanf(infile ,"%lf%lf%lf", &x[i], &y[i], &z[i] ) != 3) break;
         }
     }
@@ -242,7 +487,7 @@ void readcols(char *fname, double x[], double y[], double z[], size_t N,\
         }
 
         // Apply to the time vector
-        for (size_t j = 0; j < N+1; ++j) {
+        for (size_t j = 0; j < N; ++j) {
             x[j] *= scaling;
         }
     }
@@ -252,6 +497,73 @@ void readcols(char *fname, double x[], double y[], double z[], size_t N,\
 }
 
 
+// Read the data and calculate the weights in one pass (see readcols).
+// The mean and the sum of squared deviations of the window are updated as
+// a point enters and the oldest leaves (stored in a ring buffer). Points
+// before the first window with a scatter (e.g. the first point) get the
+// weight of the first window with one.
+void movweight(FILE *infile, double x[], double y[], double z[], size_t N,\
+               int wmode, int wlen)
+{
+    if ( wlen < 2 ) wlen = 2;
+    double* ring = malloc(wlen * sizeof(double));
+    size_t n = 0;
+    size_t pend = 0;
+    size_t i;
+    double mean = 0;
+    double m2 = 0;
+    double s, old, prev, var;
+
+    for (i = 0; i < N; ++i) {
+        // Read the point and the value entering the window
+        if ( wmode == 1 ) {
+            if ( fscanf(infile ,"%lf%lf", &x[i], &y[i] ) != 2) break;
+            s = y[i];
+        }
+        else {
+            if ( fscanf(infile ,"%lf%lf%lf", &x[i], &y[i], &s ) != 3) break;
+        }
+
+        // Uncertainties
+        if ( wmode == 3 ) {
+            z[i] = ( s != 0 ) ? 1.0 / (s * s) : 0;
+            pend = i + 1;
+            continue;
+        }
+
+        // Update the window (growing, or replacing the oldest value)
+        if ( n < (size_t) wlen ) {
+            n++;
+            prev = mean;
+            mean += (s - prev) / n;
+            m2 += (s - prev) * (s - mean);
+        }
+        else {
+            old = ring[i % wlen];
+            prev = mean;
+            mean += (s - old) / n;
+            m2 += (s - old) * (s - mean + old - prev);
+        }
+        if ( m2 < 0 ) m2 = 0;
+        ring[i % wlen] = s;
+
+        // Weight (also for the points waiting for a scatter)
+        var = m2 / n;
+        if ( var > 0 ) {
+            for (; pend <= i; ++pend) {
+                z[pend] = 1.0 / var;
+            }
+        }
+    }
+
+    // No scatter at all: Equal weights
+    for (; pend < i; ++pend) {
+        z[pend] = 1;
+    }
+    free(ring);
+}
+
+
 /* Write file with two columns of data */
 void writecols(char *fname, double x[], double y[], size_t N)
 {
@@ -267,27 +579,90 @@ void writecols(char *fname, double x[], double y[], size_t N)
 }
 
 
+/* Read file with the limits of a filter bank (two columns: f1 f2 per line,
+ * lines starting with '#' and empty lines are skipped)
+ *  --> Returns the number of bands read. Quits on a malformed line, a band
+ *      with f1 >= f2 or more than `Nmax` bands
+ */
+size_t readbands(char *fname, double f1[], double f2[], size_t Nmax)
+{
+    size_t nbands = 0;
+    size_t nline = 0;
+    char line[1000];
+    char extra;
+
+    // Read the frequencies in pairs
+    FILE* infile = fopen(fname, "r");
+    if ( infile == 0 ) {
+        fprintf(stderr, "Could not open file:  %s \n", fname);
+        exit(1);
+    }
+    while ( fgets(line, sizeof(line), infile) != NULL ) {
+        nline++;
+        size_t skip = strspn(line, " \t\r\n");
+        if ( line[skip] == '#' || line[skip] == '\0' ) continue;
+        if ( nbands == Nmax ) {
+            fprintf(stderr, "Too many bands in \"%s\" (max. %li)! Quitting!"\
+                    "\n", fname, Nmax);
+            exit(1);
+        }
+        if ( sscanf(line, "%lf%lf %c", &f1[nbands], &f2[nbands], &extra)\
+             != 2 ) {
+            fprintf(stderr, "Wrong band in line %li of \"%s\"! Quitting!\n",\
+                    nline, fname);
+            exit(1);
+        }
+        if ( f1[nbands] >= f2[nbands] ) {
+            fprintf(stderr, "Band in line %li of \"%s\" is empty (%.2lf >="\
+                    " %.2lf)! Quitting!\n", nline, fname, f1[nbands],\
+                    f2[nbands]);
+            exit(1);
+        }
+        nbands++;
+    }
+    fclose(infile);
+
+    return nbands;
+}
+
+
+/* Read the frequencies from the first column of a file (lines starting with
+ * '#' are skipped)
+ *  --> Returns the number of frequencies read (at most `Nmax`)
+ */
+size_t readlist(char *fname, double x[], size_t Nmax)
+{
+    size_t n = 0;
+    char line[1000];
+
+    FILE* infile = fopen(fname, "r");
+    if ( infile == 0 ) {
+        fprintf(stderr, "Could not open file:  %s \n", fname);
+        exit(1);
+    }
+    while ( n < Nmax && fgets(line, sizeof(line), infile) != NULL ) {
+        if ( line[0] == '#' ) continue;
+        if ( sscanf(line, "%lf", &x[n]) == 1 ) n++;
+    }
+    fclose(infile);
+
+    return n;
+}
+
+
 /* Write file with two or three columns of data and units */
 void writecols3(char *fname, double x[], double y[], double z[], size_t N,\
                 int three, int unit)
 {
-    // Convert units (to match original data)
-    if ( unit != 1 ) {
-        double scaling = 1;
-        
+    // Convert units (to match original data) -- the times are not changed
+    double scaling = 1;
+    if ( unit == 2 ) {
         // Days
-        if ( unit == 2 ) {
-            scaling = 86400.0;
-        }
+        scaling = 86400.0;
+    }
+    else if ( unit == 3 ) {
         // Mega seconds
-        else if ( unit == 3 ) {
-            scaling = 1e6;
-        }
-
-        // Apply to the time vector
-        for (size_t j = 0; j < N+1; ++j) {
-            x[j] /= scaling;
-        }
+        scaling = 1e6;
     }
 
     // Open file
@@ -297,14 +672,50 @@ void writecols3(char *fname, double x[], double y[], double z[], size_t N,\
     if (outfile != NULL) {
         if ( three == 0 ) {
             for ( size_t i = 0; i < N; ++i ) {
-                fprintf(outfile, "%15.9e %18.9e\n", x[i], y[i]);
+                fprintf(outfile, "%15.9e %18.9e\n", x[i]/scaling, y[i]);
             }
         }
         else {
             for ( size_t i = 0; i < N; ++i ) {
-                fprintf(outfile, "%15.9e %18.9e %18.9e\n", x[i], y[i], z[i]);
+                fprintf(outfile, "%15.9e %18.9e %18.9e\n", x[i]/scaling, y[i],\
+                        z[i]);
             }            
         }
         fclose(outfile);
     }
 }
+
+
+/* Write file with time, B columns of data and (optionally) weights
+ *  --> The data in `y` is stored band after band (y[b*N + i])
+ */
+void writecolsN(char *fname, double x[], double y[], double z[], size_t N,\
+                size_t B, int three, int unit)
+{
+    // Convert units (to match original data) -- the times are not changed
+    double scaling = 1;
+    if ( unit == 2 ) {
+        // Days
+        scaling = 86400.0;
+    }
+    else if ( unit == 3 ) {
+        // Mega seconds
+        scaling = 1e6;
+    }
+
+    // Open file
+    FILE* outfile = fopen(fname, "w");
+
+    // Check if file is available
+    if (outfile != NULL) {
+        for ( size_t i = 0; i < N; ++i ) {
+            fprintf(outfile, "%15.9e", x[i]/scaling);
+            for ( size_t b = 0; b < B; ++b ) {
+                fprintf(outfile, " %18.9e", y[b*N + i]);
+            }
+            if ( three != 0 ) fprintf(outfile, " %18.9e", z[i]);
+            fprintf(outfile, "\n");
+        }
+        fclose(outfile);
+    }
+}
@@ -1,14 +1,26 @@
 int cmdarg(int argc, char *argv[], char inname[], char outname[], int *quiet,\
            int *unit, int *prep, double *low, double *high, double *rate,\
            int *autosamp, int *fast, int *useweight, int *windowmode,\
-           double *winfreq, int *CLEAN, int *filter, double *fstart,\
-           double *fstop);
+           double winfreq[], size_t *nwin, int *CLEAN, int *filter,\
+           double *fstart, double *fstop, char bankname[], int *engine,\
+           double *binmargin, int *trig, double *ckpt, int *nreal,\
+           int *famode, int *harmonics, int *freqmode, char listname[],\
+           int *nbins, int *covers, double *qmin, double *qmax,\
+           int *npeaks, int *numa, int *pyramid, int *wmode, int *wlen);
+
+size_t countlines(char *fname);
 
 void readcols(char *fname, double x[], double y[], double z[], size_t N,\
-              int three, int unit, int quiet);
+              int three, int wmode, int wlen, int unit, int quiet);
+
+size_t readbands(char *fname, double f1[], double f2[], size_t Nmax);
+
+size_t readlist(char *fname, double x[], size_t Nmax);
 
 void writecols(char *fname, double x[], double y[], size_t N);
 
 void writecols3(char *fname, double x[], double y[], double z[], size_t N,\
                 int three, int unit);
 
+void writecolsN(char *fname, double x[], double y[], double z[], size_t N,\
+                size_t B, int three, int unit);
@@ -3,10 +3,17 @@
  * Usage:
  * filter.x [options] mode sampling inputfile outputfile
  *
- * Mode: -{band freq1 freq2 | low freq | high freq}
+ * Mode: -{band freq1 freq2 | low freq | high freq | bank file}
  *   band: Bandpass filter between freq1 and freq2 (in microHz).
  *   low : Lowpass filter with freq (in microHz) as limit.
  *   high: Highpass filter with freq (in microHz) as limit.
+ *   bank: Filter bank. Bandpass filters for all of the bands listed in file
+ *         (one band per line: freq1 freq2, with freq1 < freq2; lines starting
+ *         with '#' are skipped). The spectrum and the window are only
+ *         calculated once, and each band is sampled as with -band (so every
+ *         filter equals the bandpass filter of its band). The output file
+ *         will contain the times followed by one column per band (and the
+ *         weights if given).
  * 
  * Sampling: -f {auto | low high rate}
  *   auto: Calculate power spectrum from 5 microHertz to Nyquist frequency
@@ -17,11 +24,24 @@
  * Options:
  *  -w: Calculate weighted power spectrum -- requires an extra column in the
  *      input file containing weight per data point.
+ *  -wscatter number [column], -wsigma: Weights from the scatter in a moving
+ *         window, or from uncertainties in the input file (see powerspec.c).
  *  -q: Quiet-mode. No output to console.
  *  -t{sec|day|ms}: Unit of input file (seconds [default], days, megaseconds).
  *  -fast: Fast-mode. Disable Nyquist calculation (and hence automatic
  *         sampling range) for lower runtime. Activates quiet-mode. Use for
  *         benchmarking the pure I/O + algorithm.
+ *  -bin margin: Bin the time series before filtering (weighted means of
+ *               times and data, skipping gaps). The bins are as long as
+ *               possible while keeping the Nyquist frequency of the binned
+ *               series `margin` (> 1) times above the highest frequency. The
+ *               attenuation of the amplitude is reported. Without weights,
+ *               the number of points per bin is used as weights.
+ *  -engine {auto|tune|direct|fft|zoom|float}: Engine for the power spectrum
+ *         and the window function (see powerspec.c). auto [default] and tune
+ *         choose from the cost model for the sampling.
+ *  -trig {exact|1e-10|1e-6}: Accuracy of sin/cos in the direct sums (see
+ *         powerspec.c).
  *
  * Note:
  * Using multi-threading with OpenMP. Set number of threads used by the shell
@@ -32,6 +52,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <math.h>
 #include <omp.h>
 
@@ -40,6 +61,9 @@
 #include "tsfourier.h"
 #include "window.h"
 #include "pass.h"
+#include "preproc.h"
+#include "tune.h"
+#include "series.h"
 
 #define PI2micro 6.28318530717958647692528676655900576839433879875e-6
 
@@ -63,18 +87,34 @@ int main(int argc, char *argv[])
     int autosamp = 0;
     int fast = 0;
     int useweight = 0;
+    int wmode = 0;
+    int wlen = 0;
     int Nclean = 0;
-    int filter = 1;  // 1 is init, 2 is bandpass, 3 is low, 4 is high
+    int engine = 0;
+    double binmargin = 0;
+    int trig = 0;
+    int filter = 1;  // 1 is init, 2 is bandpass, 3 is low, 4 is high,
+                     // 5 is filter bank
 
     // Filtering frequencies
     double fstart = 0;
     double fstop = 0;
 
+    // Filter bank
+    char bankname[100];
+    size_t B = 1;  // Number of bands
+
     
     /* Process command line arguments and return line count of the input file */
     N = cmdarg(argc, argv, inname, outname, &quiet, &unit, NULL, &low, &high,\
-               &rate, &autosamp, &fast, &useweight, NULL, NULL, &Nclean,\
-               &filter, &fstart, &fstop);
+               &rate, &autosamp, &fast, &useweight, NULL, NULL, NULL,\
+               &Nclean, &filter, &fstart, &fstop, bankname, &engine,\
+               &binmargin, &trig, NULL, NULL, NULL, NULL, NULL, NULL, NULL,\
+               NULL, NULL, NULL, NULL, NULL, NULL, &wmode, &wlen);
+    int measure = ( engine == 5 );  // -engine tune
+    if ( measure != 0 ) engine = 0;
+    fourier_setengine(engine);
+    fourier_settrig(trig);
 
     // Pretty print
     if ( quiet == 0 || fast == 1){
@@ -92,12 +132,13 @@ int main(int argc, char *argv[])
     double* time = malloc(N * sizeof(double));
     double* flux = malloc(N * sizeof(double));
     double* weight = malloc(N * sizeof(double));
-    readcols(inname, time, flux, weight, N, useweight, unit, quiet);
+    readcols(inname, time, flux, weight, N, useweight, wmode, wlen,\
+             unit, quiet);
 
     // Do if fast-mode is not activated
     if ( fast == 0 ) {
         // Calculate Nyquist frequency
-        double* dt = malloc(N-1 * sizeof(double));
+        double* dt = malloc((N-1) * sizeof(double));
         double nyquist;
         arr_diff(time, dt, N);
         nyquist = 1.0 / (2.0 * arr_median(dt, N-1)) * 1e6; // microHz !
@@ -124,43 +165,86 @@ int main(int argc, char *argv[])
     }
 
     
+    // Bin the time series? (The filtered series is at the binned times)
+    if ( binmargin > 0 ) {
+        N = binning(time, flux, weight, N, high, binmargin, &useweight, quiet);
+    }
+
+    
+    // Choose the engine for the sampling
+    if ( engine == 0 ) {
+        engine = tune_engine(time, N, low, rate,\
+                             arr_util_getstep(low, high, rate), measure,\
+                             quiet);
+        fourier_setengine(engine);
+    }
+
+    
     /* Run the desired filter */
-    // Init output array
-    double* filt = malloc(N * sizeof(double));
+    // Read the bands of the filter bank
+    double* f1 = NULL;
+    double* f2 = NULL;
+    if ( filter == 5 ) {
+        size_t Nmax = countlines(bankname) + 1;
+        f1 = malloc(Nmax * sizeof(double));
+        f2 = malloc(Nmax * sizeof(double));
+        B = readbands(bankname, f1, f2, Nmax);
+        if ( B == 0 ) {
+            fprintf(stderr, "ERROR: No bands found in \"%s\" !\n", bankname);
+            exit(1);
+        }
+    }
+
+    // Init output array (one series per band)
+    double* filt = malloc(B * N * sizeof(double));
+
+    // Prepared series shared by the window and the spectrum of the filter
+    struct series* ser = series_prepare(time, flux, weight, N, useweight);
 
     if ( filter == 2 ) {
         if ( quiet == 0 ) {
             printf(" - Calculating bandpass filter between %.2lf and %.2lf"\
                    " microHz\n", fstart, fstop);
         }
-        bandpass(time, flux, weight, N, fstart, fstop, low, high, rate, filt,\
-                 useweight, quiet);
+        bandpass_series(ser, fstart, fstop, low, high, rate, filt, quiet);
     }
     else if ( filter == 3 ) {
         if ( quiet == 0 ) {
             printf(" - Calculating lowpass filter up to %.2lf microHz\n",\
                    fstop);
         }
-        lowpass(time, flux, weight, N, fstop, low, high, rate, filt,\
-                useweight, quiet);
+        lowpass_series(ser, fstop, low, high, rate, filt, quiet);
     }
     else if ( filter == 4 ) {
         if ( quiet == 0 ) {
             printf(" - Calculating highpass filter from %.2lf microHz\n",\
                    fstop);
         }
-        highpass(time, flux, weight, N, fstop, low, high, rate, filt,\
-                 useweight, quiet);
+        highpass_series(ser, fstop, low, high, rate, filt, quiet);
+    }
+    else if ( filter == 5 ) {
+        if ( quiet == 0 ) {
+            printf(" - Calculating filter bank of %li bands\n", B);
+            for (size_t b = 0; b < B; ++b) {
+                printf(" -- INFO: Band %li: %.2lf to %.2lf microHz\n", b+1,\
+                       f1[b], f2[b]);
+            }
+        }
+        filterbank_series(ser, f1, f2, B, low, high, rate, filt, quiet);
     }
     else {
         fprintf(stderr, "ERROR: Unknown filter chosen !");
     }
+    series_free(ser);
 
     /* Write filtered time series to file */
     if ( quiet == 0 ) printf(" - Saving to file \"%s\"\n", outname);
 
     // Save to file
-    writecols3(outname, time, filt, weight, N, useweight, unit);
+    if ( filter == 5 )
+        writecolsN(outname, time, filt, weight, N, B, useweight, unit);
+    else
+        writecols3(outname, time, filt, weight, N, useweight, unit);
 
     
     /* Free data */
@@ -168,6 +252,8 @@ int main(int argc, char *argv[])
     free(flux);
     free(weight);
     free(filt);
+    free(f1);
+    free(f2);
 
 
     /* Done! */
@@ -0,0 +1,80 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Grids of sampling frequencies (shared by the spectrum and period searches)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arrlib.h"
+#include "fileio.h"
+#include "dist.h"
+
+
+/* Sampling frequencies: From `low` to `high` in steps of `rate` (freqmode =
+ * 0), the frequencies listed in a file (1), windows of +/- `low` around
+ * the listed frequencies in steps of `rate` (2), or `rate` frequencies from
+ * `low` to `high` equidistant in the logarithm (3)
+ *  --> The list is read by the first process and broadcasted
+ *  --> Returns the (allocated) frequencies and stores their number in M and
+ *      the number of listed frequencies in nlist
+ */
+double* freqgrid(int freqmode, char listname[], double low, double high,\
+                 double rate, int rank, size_t *M, size_t *nlist)
+{
+    double* freq = NULL;
+    *M = 0;
+    *nlist = 0;
+
+    // Linear grid
+    if ( freqmode == 0 ) {
+        *M = arr_util_getstep(low, high, rate);
+        freq = malloc(*M * sizeof(double));
+        arr_init_linspace(freq, low, rate, *M);
+        return freq;
+    }
+
+    // Logarithmic grid
+    if ( freqmode == 3 ) {
+        if ( low <= 0 || high <= low || rate < 1 ) {
+            fprintf(stderr, "Wrong logarithmic grid! Quitting!\n");
+            exit(1);
+        }
+        *M = (size_t) rate;
+        freq = malloc(*M * sizeof(double));
+        arr_init_logspace(freq, low, high, *M);
+        return freq;
+    }
+
+    // Read the list
+    double n = 0;
+    if ( rank == 0 ) n = countlines(listname) + 1;
+    dist_bcast(&n, 1);
+    double* list = malloc(n * sizeof(double));
+    if ( rank == 0 ) n = readlist(listname, list, n);
+    dist_bcast(&n, 1);
+    dist_bcast(list, n);
+    *nlist = n;
+    if ( *nlist == 0 ) {
+        fprintf(stderr, "No frequencies in \"%s\"! Quitting!\n", listname);
+        exit(1);
+    }
+
+    // The listed frequencies (in the given order)
+    if ( freqmode == 1 ) {
+        *M = *nlist;
+        return list;
+    }
+
+    // Windows around the (sorted) frequencies
+    if ( low < 0 || rate <= 0 ) {
+        fprintf(stderr, "Wrong width or rate of the windows! Quitting!\n");
+        exit(1);
+    }
+    arr_sort(list, *nlist);
+    *M = arr_util_around(list, *nlist, low, rate, NULL);
+    freq = malloc(*M * sizeof(double));
+    arr_util_around(list, *nlist, low, rate, freq);
+    free(list);
+    return freq;
+}
@@ -0,0 +1,2 @@
+double* freqgrid(int freqmode, char listname[], double low, double high,\
+                 double rate, int rank, size_t *M, size_t *nlist);
@@ -0,0 +1,187 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Multi-harmonic least-squares spectrum
+ *
+ * At every frequency, K harmonics (sin and cos of k*ny*t, k = 1..K) are
+ * fitted simultaneously by solving the (2K)x(2K) normal equations. The power
+ * is the sum of the squared amplitudes of all harmonics; for K = 1 it is the
+ * power of fourier().
+ *
+ * Only sin/cos of the fundamental are evaluated per point: the harmonics
+ * follow from the Chebyshev recurrence
+ *    cos((m+1)x) = 2 cos(x) cos(mx) - cos((m-1)x)     (and the same for sin).
+ * The elements of the normal matrix are products of two harmonics, which
+ * are reduced to sums of single harmonics up to 2K, e.g.
+ *    sin(px) sin(qx) = (cos((p-q)x) - cos((p+q)x)) / 2 ,
+ * so the work per point and frequency is O(K) rather than O(K^2).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "arrlib.h"
+
+#define PI2micro 6.28318530717958647692528676655900576839433879875e-6
+
+// Max. number of harmonics
+#define HARMMAX 16
+
+int harmcoeffs(double time[], double flux[], double weight[], size_t N,\
+               double ny, int K, double wsum, int useweight, double coef[]);
+
+int cholsolve(double A[], double b[], int n);
+
+
+/* Multi-harmonic power spectrum
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `flux`     : Array of data (with the mean subtracted).
+ *  - `weight`   : Array of statistical weights.
+ *  - `freq`     : Array of cyclic (fundamental) frequencies to sample.
+ *  - `N`        : Length of the time series
+ *  - `M`        : Length of the sampling vector
+ *  - `K`        : Number of harmonics (1 to 16)
+ *  - `power`    : OUTPUT -- Array with the sum of the squared amplitudes of
+ *                 all harmonics
+ *  - `alpha`    : OUTPUT -- Array with the sin-coefficient of the fundamental
+ *  - `beta`     : OUTPUT -- Array with the cos-coefficient of the fundamental
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ *
+ * Frequencies where the normal equations are singular (e.g. a harmonic at
+ * zero or at the Nyquist frequency of a regular sampling) get zero power.
+ */
+void fourierharm(double time[], double flux[], double weight[], double freq[],\
+                 size_t N, size_t M, int K, double power[], double alpha[],\
+                 double beta[], int useweight)
+{
+    if ( K < 1 ) K = 1;
+    if ( K > HARMMAX ) K = HARMMAX;
+    double wsum = (useweight != 0) ? arr_sum(weight, N) : N;
+
+    // Make parallel loop over all test frequencies
+    #pragma omp parallel default(shared)
+    {
+        double coef[2*HARMMAX];
+
+        #pragma omp for schedule(static)
+        for (size_t j = 0; j < M; ++j) {
+            double p = 0;
+            if ( harmcoeffs(time, flux, weight, N, freq[j] * PI2micro, K,\
+                            wsum, useweight, coef) == 0 ) {
+                for (int k = 0; k < 2*K; ++k) {
+                    p += coef[k] * coef[k];
+                }
+            }
+            else {
+                coef[0] = 0;
+                coef[K] = 0;
+            }
+            alpha[j] = coef[0];
+            beta[j] = coef[K];
+            power[j] = p;
+        }
+    }
+}
+
+
+// Least-squares coefficients of K harmonics at the angular frequency ny
+//  --> coef[k-1]: sin(k*ny*t), coef[K+k-1]: cos(k*ny*t)
+//  --> Returns 0 on success, 1 if the normal equations are singular
+int harmcoeffs(double time[], double flux[], double weight[], size_t N,\
+               double ny, int K, double wsum, int useweight, double coef[])
+{
+    // Sums of single harmonics (weights, data times weights)
+    double C[2*HARMMAX + 1] = {0};
+    double S[2*HARMMAX + 1] = {0};
+    double xs[HARMMAX] = {0};
+    double xc[HARMMAX] = {0};
+    double cm[2*HARMMAX + 1], sm[2*HARMMAX + 1];
+    double A[4*HARMMAX*HARMMAX];
+    int L = 2*K;
+
+    cm[0] = 1;
+    sm[0] = 0;
+    for (size_t i = 0; i < N; ++i) {
+        double w = ( useweight != 0 ) ? weight[i] : 1;
+        double x = w * flux[i];
+
+        // Harmonics by recurrence
+        double c1 = cos(ny * time[i]);
+        double s1 = sin(ny * time[i]);
+        cm[1] = c1;
+        sm[1] = s1;
+        for (int m = 2; m <= L; ++m) {
+            cm[m] = 2*c1*cm[m-1] - cm[m-2];
+            sm[m] = 2*c1*sm[m-1] - sm[m-2];
+        }
+
+        for (int m = 1; m <= L; ++m) {
+            C[m] += w * cm[m];
+            S[m] += w * sm[m];
+        }
+        for (int k = 0; k < K; ++k) {
+            xs[k] += x * sm[k+1];
+            xc[k] += x * cm[k+1];
+        }
+    }
+    C[0] = wsum;
+
+    // Normal equations from the sums (p, q = 1..K)
+    for (int p = 1; p <= K; ++p) {
+        for (int q = 1; q <= K; ++q) {
+            int d = abs(p - q);
+            double Sd = ( p >= q ) ? S[d] : -S[d];
+            A[(p-1)*L + (q-1)]     = 0.5 * (C[d] - C[p+q]);   // sin p, sin q
+            A[(K+p-1)*L + (K+q-1)] = 0.5 * (C[d] + C[p+q]);   // cos p, cos q
+            A[(p-1)*L + (K+q-1)]   = 0.5 * (S[p+q] + Sd);     // sin p, cos q
+            A[(K+q-1)*L + (p-1)]   = A[(p-1)*L + (K+q-1)];
+        }
+        coef[p-1] = xs[p-1];
+        coef[K+p-1] = xc[p-1];
+    }
+
+    return cholsolve(A, coef, L);
+}
+
+
+// Solve A x = b for symmetric, positive definite A (n x n, row-major) using
+// the Cholesky decomposition -- IN-PLACE (x is returned in b)
+//  --> Returns 1 if A is (numerically) singular
+int cholsolve(double A[], double b[], int n)
+{
+    // Decomposition A = L L^T (L in the lower triangle)
+    for (int j = 0; j < n; ++j) {
+        double d = A[j*n + j];
+        for (int k = 0; k < j; ++k) {
+            d -= A[j*n + k] * A[j*n + k];
+        }
+        if ( d <= 1e-12 * A[j*n + j] || d <= 0 ) return 1;
+        d = sqrt(d);
+        A[j*n + j] = d;
+        for (int i = j + 1; i < n; ++i) {
+            double s = A[i*n + j];
+            for (int k = 0; k < j; ++k) {
+                s -= A[i*n + k] * A[j*n + k];
+            }
+            A[i*n + j] = s / d;
+        }
+    }
+
+    // Forward and back substitution
+    for (int i = 0; i < n; ++i) {
+        for (int k = 0; k < i; ++k) {
+            b[i] -= A[i*n + k] * b[k];
+        }
+        b[i] /= A[i*n + i];
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        for (int k = i + 1; k < n; ++k) {
+            b[i] -= A[k*n + i] * b[k];
+        }
+        b[i] /= A[i*n + i];
+    }
+    return 0;
+}
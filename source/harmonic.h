@@ -0,0 +1,3 @@
+void fourierharm(double time[], double flux[], double weight[], double freq[],\
+                 size_t N, size_t M, int K, double power[], double alpha[],\
+                 double beta[], int useweight);
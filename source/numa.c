@@ -0,0 +1,133 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Placement of the threads and the data on NUMA nodes (-numa)
+ *
+ * The OpenMP threads are pinned to the cores allowed for the process (thread
+ * t on the t-th core, so consecutive threads share a node), and the node of
+ * each thread is taken from "/sys/devices/system/cpu". The pinning is done
+ * in a parallel region with all threads, and holds for the later regions
+ * with the same number of threads (the runtime keeps its threads).
+ *
+ * With the node of every thread known, read-only data can be replicated on
+ * each node (see series_replicate), and arrays written by a static loop are
+ * touched first by the thread which will write them (numa_firsttouch), so
+ * their pages are placed on the node of that thread.
+ *
+ * Linux only; elsewhere (or if the affinity cannot be read) nothing is done
+ * and all threads are on node 0.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sched.h>
+#include <omp.h>
+
+// Max. number of threads and nodes handled
+#define NUMATHREADS 1024
+#define NUMANODES 64
+
+// Node (dense index) of each thread and the number of nodes in use
+static int nodeof[NUMATHREADS];
+static int nnodes = 1;
+
+int cpunode(int cpu);
+
+
+/* Pin the threads to the cores and find their nodes
+ *  --> Returns the number of NUMA nodes used by the threads
+ */
+int numa_pin(int quiet)
+{
+#ifdef CPU_SETSIZE
+    // Cores allowed for the process
+    cpu_set_t allowed;
+    if ( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ) return 1;
+    int* cpus = malloc(CPU_SETSIZE * sizeof(int));
+    int ncpu = 0;
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if ( CPU_ISSET(c, &allowed) ) cpus[ncpu++] = c;
+    }
+    if ( ncpu == 0 ) {
+        free(cpus);
+        return 1;
+    }
+
+    // Pin every thread to one core (each thread pins itself)
+    int node[NUMATHREADS];
+    int threads = 1;
+    #pragma omp parallel default(shared)
+    {
+        int t = omp_get_thread_num();
+        int cpu = cpus[t % ncpu];
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        sched_setaffinity(0, sizeof(one), &one);
+        if ( t < NUMATHREADS ) node[t] = cpunode(cpu);
+
+        #pragma omp single
+        threads = omp_get_num_threads();
+    }
+    free(cpus);
+    if ( threads > NUMATHREADS ) threads = NUMATHREADS;
+
+    // Dense numbering of the nodes (in order of the threads)
+    int dense[NUMANODES];
+    for (int k = 0; k < NUMANODES; ++k) {
+        dense[k] = -1;
+    }
+    nnodes = 0;
+    for (int t = 0; t < threads; ++t) {
+        if ( dense[node[t]] < 0 ) dense[node[t]] = nnodes++;
+        nodeof[t] = dense[node[t]];
+    }
+
+    if ( quiet == 0 )
+        printf(" -- INFO: %i threads pinned to cores on %i NUMA node(s)\n",\
+               threads, nnodes);
+#endif
+    return nnodes;
+}
+
+
+/* Number of NUMA nodes used by the threads (1 without numa_pin) */
+int numa_nodes(void)
+{
+    return nnodes;
+}
+
+
+/* Node (0 ... numa_nodes()-1) of the calling thread */
+int numa_node(void)
+{
+    int t = omp_get_thread_num();
+    return ( nnodes > 1 && t < NUMATHREADS ) ? nodeof[t] : 0;
+}
+
+
+/* Touch the array x (set to zero) with the same static partition as the
+ * parallel loops over it, so its pages are placed on the node of the thread
+ * which writes them
+ */
+void numa_firsttouch(double x[], size_t M)
+{
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0; i < M; ++i) {
+        x[i] = 0;
+    }
+}
+
+
+// Node of a core (0 if unknown)
+int cpunode(int cpu)
+{
+    char path[100];
+    for (int k = 0; k < NUMANODES; ++k) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%i/node%i",\
+                 cpu, k);
+        if ( access(path, F_OK) == 0 ) return k;
+    }
+    return 0;
+}
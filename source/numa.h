@@ -0,0 +1,7 @@
+int numa_pin(int quiet);
+
+int numa_nodes(void);
+
+int numa_node(void);
+
+void numa_firsttouch(double x[], size_t M);
@@ -1,21 +1,46 @@
 /*  ~~~ Time Series Analysis -- Auxiliary ~~~
  *
  * Routines for calculating (band, low, high)-pass filters
+ *
+ * The filters work on a prepared series (see series.c), so the sum of the
+ * weights, weight * data and the sampling of the window are only determined
+ * once for all filters of a series. The array interfaces wrap the arrays of
+ * the caller (whose data is restored afterwards).
  * 
  * Author: Jakob Rørsted Mosumgaard
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include <omp.h>
 
 #include "arrlib.h"
 #include "window.h"
 #include "tsfourier.h"
+#include "series.h"
 
 #define PI2micro 6.28318530717958647692528676655900576839433879875e-6
 
+void bandseries(double time[], size_t N, double freq[], size_t M,\
+                double alpha[], double beta[], double sumwin, double result[]);
+
+int freqorder(const void *a, const void *b);
+
+void bandpass_series(struct series *s, double f1, double f2, double low,\
+                     double high, double rate, double result[], int quiet);
+
+void filterbank_series(struct series *s, double f1[], double f2[], size_t B,\
+                       double low, double high, double rate, double result[],\
+                       int quiet);
+
+void lowpass_series(struct series *s, double flow, double low, double high,\
+                    double rate, double result[], int quiet);
+
+void highpass_series(struct series *s, double fhigh, double low, double high,\
+                     double rate, double result[], int quiet);
 
 
 /* Bandpass filter
@@ -36,12 +61,30 @@ void bandpass(double time[], double flux[], double weight[], size_t N,\
               double f1, double f2, double low, double high, double rate,\
               double result[], int useweight, int quiet)
 {
+    struct series ser;
+    series_wrap(&ser, time, flux, weight, N, useweight);
+    bandpass_series(&ser, f1, f2, low, high, rate, result, quiet);
+
+    // Add the mean again to the data of the caller
+    arr_sca_add(flux, ser.mean, N);
+    series_free(&ser);
+}
+
+
+/* Bandpass filter of a prepared time series (see series.c)
+ *  --> As bandpass(). The mean is subtracted from the data of the series
+ *      (see series_submean) and added to the filtered data
+ */
+void bandpass_series(struct series *s, double f1, double f2, double low,\
+                     double high, double rate, double result[], int quiet)
+{
+    size_t N = s->N;
+
     // Calculate the (sum of the) window function at central frequency
     if ( quiet == 0 )
         printf(" -- TASK: Calculating window function ... \n");
     double fwin = (low + high)/2.0;
-    double sumwin = windowsum(fwin, low, high, rate, time, weight, N,\
-                              useweight, quiet);
+    double sumwin = windowsum_series(s, fwin, low, high, rate, quiet);
     if ( quiet == 0 ) printf("      ... Done!\n");
 
     // Fill sampling vector with cyclic frequencies
@@ -57,16 +100,43 @@ void bandpass(double time[], double flux[], double weight[], size_t N,\
     double* beta = malloc(M * sizeof(double));
 
     // Subtract the mean to avoid "zero-frequency" problems
-    double fmean = arr_mean(flux, N);
-    arr_sca_add(flux, -fmean, N);
+    series_submean(s);
 
     // Calculate power spectrum and save alphas and betas
     if ( quiet == 0 ) printf(" -- TASK: Calculating power spectrum ... \n");
-    fourier(time, flux, weight, freq, N, M, power, alpha, beta, useweight);
+    fourier_series(s, freq, M, power, alpha, beta);
     if ( quiet == 0 ) printf("      ... Done!\n");
 
     // Generate new time series
     if ( quiet == 0 ) printf(" -- TASK: Calculating new time series ... \n");
+    bandseries(s->time, N, freq, M, alpha, beta, sumwin, result);
+    if ( quiet == 0 ) printf("      ... Done!\n");
+
+    // Add the mean again to the filter
+    arr_sca_add(result, s->mean, N);
+
+    // Done!
+    free(freq);
+    free(power);
+    free(alpha);
+    free(beta);
+}
+
+
+/* Sum the sinusoids of a spectrum -- the bandpassed time series
+ *
+ * Arguments:
+ *  - `time`         : Array of times. In seconds!
+ *  - `N`            : Length of the time series
+ *  - `freq`         : Array of frequencies in the band (in microHz)
+ *  - `M`            : Length of freq
+ *  - `alpha`, `beta`: Arrays with the coefficients of the spectrum
+ *  - `sumwin`       : Sum of the window function (see windowsum)
+ *  - `result`       : OUTPUT -- Array containing filtered data
+ */
+void bandseries(double time[], size_t N, double freq[], size_t M,\
+                double alpha[], double beta[], double sumwin, double result[])
+{
     double sumfilt, ny;
     #pragma omp parallel default(shared) private(sumfilt, ny)
     {
@@ -80,14 +150,141 @@ void bandpass(double time[], double flux[], double weight[], size_t N,\
             result[i] = sumfilt / sumwin;
         }
     }
+}
+
+
+/* Filter bank -- several bandpass filters from a single spectrum
+ *  --> The window sum and the spectrum (over the union of the bands) are
+ *      only calculated once, and all filtered series are made in one pass.
+ *      Each band is sampled as by bandpass (from f1 in steps of rate), so
+ *      every series equals the bandpass filter of its band
+ *
+ * Arguments:
+ *  - `time`       : Array of times. In seconds!
+ *  - `flux`       : Array of data.
+ *  - `weight`     : Array of statistical weights.
+ *  - `N`          : Length of the time series
+ *  - `f1`, `f2`   : Arrays with the frequency intervals of the filters
+ *  - `B`          : Number of bands (length of f1 and f2)
+ *  - `low`, `high`: Frequency interval to calculate the spectrum
+ *  - `rate`       : Frequency sampling
+ *  - `result`     : OUTPUT -- Array (B*N) with filtered data (band by band)
+ *  - `useweight`  : Flag to signal whether to use weights or not (0 = no weights)
+ *  - `quiet`      : Flag. 0 = verbose output. 1 = no output to console
+ */
+void filterbank(double time[], double flux[], double weight[], size_t N,\
+                double f1[], double f2[], size_t B, double low, double high,\
+                double rate, double result[], int useweight, int quiet)
+{
+    struct series ser;
+    series_wrap(&ser, time, flux, weight, N, useweight);
+    filterbank_series(&ser, f1, f2, B, low, high, rate, result, quiet);
+
+    // Add the mean again to the data of the caller
+    arr_sca_add(flux, ser.mean, N);
+    series_free(&ser);
+}
+
+
+/* Filter bank of a prepared time series (see series.c)
+ *  --> As filterbank(), with the mean subtracted as in bandpass_series
+ */
+void filterbank_series(struct series *s, double f1[], double f2[], size_t B,\
+                       double low, double high, double rate, double result[],\
+                       int quiet)
+{
+    double* time = s->time;
+    size_t N = s->N;
+
+    // Calculate the (sum of the) window function at central frequency
+    if ( quiet == 0 )
+        printf(" -- TASK: Calculating window function ... \n");
+    double fwin = (low + high)/2.0;
+    double sumwin = windowsum_series(s, fwin, low, high, rate, quiet);
+    if ( quiet == 0 ) printf("      ... Done!\n");
+
+    // Grid of each band as in bandpass: from f1 in steps of rate (the
+    // frequencies of all bands follow each other in fband)
+    size_t* off = malloc((B + 1) * sizeof(size_t));
+    off[0] = 0;
+    for (size_t b = 0; b < B; ++b) {
+        off[b+1] = off[b] + arr_util_getstep(f1[b], f2[b], rate);
+    }
+    double* fband = malloc(off[B] * sizeof(double));
+    for (size_t b = 0; b < B; ++b) {
+        arr_init_linspace(&fband[off[b]], f1[b], rate, off[b+1] - off[b]);
+    }
+
+    // Spectrum on the distinct frequencies of all bands (sorted), and the
+    // position of every frequency of the bands in it
+    double* freq = malloc(off[B] * sizeof(double));
+    memcpy(freq, fband, off[B] * sizeof(double));
+    qsort(freq, off[B], sizeof(double), freqorder);
+    size_t M = 0;
+    for (size_t j = 0; j < off[B]; ++j) {
+        if ( M == 0 || freq[j] != freq[M-1] ) freq[M++] = freq[j];
+    }
+    size_t* pos = malloc(off[B] * sizeof(size_t));
+    for (size_t k = 0; k < off[B]; ++k) {
+        size_t lo = 0;
+        size_t hi = M - 1;
+        while ( lo < hi ) {
+            size_t mid = (lo + hi) / 2;
+            if ( freq[mid] < fband[k] ) lo = mid + 1;
+            else hi = mid;
+        }
+        pos[k] = lo;
+    }
+    free(fband);
+    if ( quiet == 0 )
+        printf(" -- INFO: Number of sampling frequencies = %li\n", M);
+
+    // Arrays for data storage
+    double* power = malloc(M * sizeof(double));
+    double* alpha = malloc(M * sizeof(double));
+    double* beta = malloc(M * sizeof(double));
+
+    // Subtract the mean to avoid "zero-frequency" problems
+    series_submean(s);
+    double fmean = s->mean;
+
+    // Calculate power spectrum and save alphas and betas
+    if ( quiet == 0 ) printf(" -- TASK: Calculating power spectrum ... \n");
+    fourier_series(s, freq, M, power, alpha, beta);
     if ( quiet == 0 ) printf("      ... Done!\n");
 
-    // Add the mean again -- also to the filter
-    arr_sca_add(flux, fmean, N);
-    arr_sca_add(result, fmean, N);
+    // Generate all the new time series
+    //  --> The sinusoids of each point are evaluated once and shared by all
+    //      of the bands
+    if ( quiet == 0 ) printf(" -- TASK: Calculating new time series ... \n");
+    #pragma omp parallel default(shared)
+    {
+        double* term = malloc(M * sizeof(double));
+        double sumfilt, ny;
+
+        #pragma omp for schedule(static)
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < M; ++j) {
+                ny = freq[j] * PI2micro;
+                term[j] = alpha[j]*sin(ny*time[i]) + beta[j]*cos(ny*time[i]);
+            }
+            for (size_t b = 0; b < B; ++b) {
+                sumfilt = 0;
+                for (size_t k = off[b]; k < off[b+1]; ++k) {
+                    sumfilt += term[pos[k]];
+                }
+                result[b*N + i] = sumfilt / sumwin + fmean;
+            }
+        }
+
+        free(term);
+    }
+    if ( quiet == 0 ) printf("      ... Done!\n");
 
     // Done!
     free(freq);
+    free(off);
+    free(pos);
     free(power);
     free(alpha);
     free(beta);
@@ -120,6 +317,15 @@ void lowpass(double time[], double flux[], double weight[], size_t N,\
 }
 
 
+/* Lowpass filter of a prepared time series (see bandpass_series) */
+void lowpass_series(struct series *s, double flow, double low, double high,\
+                    double rate, double result[], int quiet)
+{
+    double fzero = rate; // Not defined for exactly zero!
+    bandpass_series(s, fzero, flow, low, high, rate, result, quiet);
+}
+
+
 /* Highpass filter
  *  --> Basically just a wrapper for the lowpass filter
  *
@@ -138,20 +344,42 @@ void lowpass(double time[], double flux[], double weight[], size_t N,\
 void highpass(double time[], double flux[], double weight[], size_t N,\
               double fhigh, double low, double high, double rate,     \
               double result[], int useweight, int quiet)
+{
+    struct series ser;
+    series_wrap(&ser, time, flux, weight, N, useweight);
+    highpass_series(&ser, fhigh, low, high, rate, result, quiet);
+
+    // Add the mean again to the data of the caller
+    arr_sca_add(flux, ser.mean, N);
+    series_free(&ser);
+}
+
+
+/* Highpass filter of a prepared time series (see bandpass_series) */
+void highpass_series(struct series *s, double fhigh, double low, double high,\
+                     double rate, double result[], int quiet)
 {
     // Make temporary array
+    size_t N = s->N;
     double* temp = malloc(N * sizeof(double));
 
     // Run lowpass filter
-    lowpass(time, flux, weight, N, fhigh, low, high, rate, temp, useweight,\
-            quiet);
+    lowpass_series(s, fhigh, low, high, rate, temp, quiet);
     
-    // Calculate highpass
+    // Calculate highpass (from the data with the mean)
     for (size_t i = 0; i < N; ++i) {
-        result[i] = flux[i] - temp[i];
+        result[i] = s->flux[i] + s->mean - temp[i];
     }
 
     // Done!
     free(temp);
 }
 
+
+// Order of two frequencies (for qsort)
+int freqorder(const void *a, const void *b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return ( x > y ) - ( x < y );
+}
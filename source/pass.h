@@ -2,6 +2,13 @@ void bandpass(double time[], double flux[], double weight[], size_t N,\
               double f1, double f2, double low, double high, double rate,\
               double result[], int useweight, int quiet);
 
+void bandseries(double time[], size_t N, double freq[], size_t M,\
+                double alpha[], double beta[], double sumwin, double result[]);
+
+void filterbank(double time[], double flux[], double weight[], size_t N,\
+                double f1[], double f2[], size_t B, double low, double high,\
+                double rate, double result[], int useweight, int quiet);
+
 void lowpass(double time[], double flux[], double weight[], size_t N,\
              double flow, double low, double high, double rate,       \
              double result[], int useweight, int quiet);
@@ -9,3 +16,18 @@ void lowpass(double time[], double flux[], double weight[], size_t N,\
 void highpass(double time[], double flux[], double weight[], size_t N,\
               double fhigh, double low, double high, double rate,     \
               double result[], int useweight, int quiet);
+
+struct series;
+
+void bandpass_series(struct series *s, double f1, double f2, double low,\
+                     double high, double rate, double result[], int quiet);
+
+void filterbank_series(struct series *s, double f1[], double f2[], size_t B,\
+                       double low, double high, double rate, double result[],\
+                       int quiet);
+
+void lowpass_series(struct series *s, double flow, double low, double high,\
+                    double rate, double result[], int quiet);
+
+void highpass_series(struct series *s, double fhigh, double low, double high,\
+                     double rate, double result[], int quiet);
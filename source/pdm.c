@@ -0,0 +1,148 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Phase dispersion minimisation (Stellingwerf 1978)
+ *
+ * The data is folded with each trial frequency and divided into bins of
+ * phase. The statistic theta is the pooled variance within the bins divided
+ * by the variance of all data: close to 1 for noise, and small at the true
+ * period (also for strongly non-sinusoidal signals).
+ *
+ * The folding is a single pass over the data: the phase of every point gives
+ * its bin directly, and the sums (weight, weight*data, weight*data^2) are
+ * accumulated per bin, so no sorting is needed. With several covers, the
+ * sums are accumulated in bins covers times finer, and each of the
+ * overlapping bins (shifted by 1/covers of a bin) is a sum of `covers`
+ * consecutive fine bins. The frequencies are split among the threads, each
+ * with its own bins.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+
+double pdmone(double time[], double flux[], double weight[], size_t N,\
+              double f, int nbins, int covers, double var, int useweight,\
+              double bins[]);
+
+
+/* PDM statistic theta for a set of trial frequencies
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `flux`     : Array of data.
+ *  - `weight`   : Array of statistical weights.
+ *  - `freq`     : Array of cyclic trial frequencies (microHz).
+ *  - `N`        : Length of the time series
+ *  - `M`        : Length of the sampling vector
+ *  - `nbins`    : Number of phase bins
+ *  - `covers`   : Number of covers (sets of bins shifted by 1/covers of a
+ *                 bin; 1 = no overlap)
+ *  - `theta`    : OUTPUT -- Array with theta for each frequency
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ */
+void pdmtheta(double time[], double flux[], double weight[], double freq[],\
+              size_t N, size_t M, int nbins, int covers, double theta[],\
+              int useweight)
+{
+    if ( nbins < 2 ) nbins = 2;
+    if ( covers < 1 ) covers = 1;
+
+    // (Unbiased) variance of all data
+    double w = 1;
+    double sw = 0;
+    double swx = 0;
+    double swxx = 0;
+    for (size_t i = 0; i < N; ++i) {
+        if ( useweight != 0 ) w = weight[i];
+        sw += w;
+        swx += w * flux[i];
+        swxx += w * flux[i] * flux[i];
+    }
+    double var = (swxx - swx * swx / sw) / sw * N / (N - 1);
+
+    // Make parallel loop over all trial frequencies (bins per thread)
+    #pragma omp parallel default(shared)
+    {
+        double* bins = malloc(4 * nbins * covers * sizeof(double));
+
+        #pragma omp for schedule(static)
+        for (size_t j = 0; j < M; ++j) {
+            theta[j] = pdmone(time, flux, weight, N, freq[j] * 1e-6, nbins,\
+                              covers, var, useweight, bins);
+        }
+
+        free(bins);
+    }
+}
+
+
+// Theta at the frequency f (Hz). `bins` has room for 4 * nbins * covers sums
+double pdmone(double time[], double flux[], double weight[], size_t N,\
+              double f, int nbins, int covers, double var, int useweight,\
+              double bins[])
+{
+    // Sums per fine bin: weights, weight*data, weight*data^2 and the number
+    // of points (without weights, the number is the sum of the weights)
+    int F = nbins * covers;
+    double* bw = bins;
+    double* bx = &bins[F];
+    double* bxx = &bins[2*F];
+    double* cnt = ( useweight != 0 ) ? &bins[3*F] : bw;
+    for (int k = 0; k < 4*F; ++k) {
+        bins[k] = 0;
+    }
+
+    // Fold
+    double phase, w, x;
+    int k;
+    if ( useweight == 0 ) {
+        for (size_t i = 0; i < N; ++i) {
+            phase = f * time[i];
+            k = (int) ((phase - floor(phase)) * F);
+            if ( k >= F ) k = F - 1;
+            x = flux[i];
+            bw[k] += 1;
+            bx[k] += x;
+            bxx[k] += x * x;
+        }
+    }
+    else {
+        for (size_t i = 0; i < N; ++i) {
+            phase = f * time[i];
+            k = (int) ((phase - floor(phase)) * F);
+            if ( k >= F ) k = F - 1;
+            w = weight[i];
+            x = flux[i];
+            bw[k] += w;
+            bx[k] += w * x;
+            bxx[k] += w * x * x;
+            cnt[k] += 1;
+        }
+    }
+
+    // Pooled variance of the (overlapping) bins: sum of n s^2 with the
+    // (weighted) variance s^2 of each bin, over the degrees of freedom
+    double s2 = 0;
+    double dof = 0;
+    for (int b = 0; b < F; ++b) {
+        double sw = 0;
+        double sx = 0;
+        double sxx = 0;
+        double n = 0;
+        for (int c = 0; c < covers; ++c) {
+            int m = (b + c) % F;
+            sw += bw[m];
+            sx += bx[m];
+            sxx += bxx[m];
+            n += cnt[m];
+        }
+        if ( n < 2 ) continue;
+        s2 += (sxx - sx * sx / sw) / sw * n;
+        dof += n - 1;
+    }
+
+    if ( dof <= 0 || var <= 0 ) return 1;
+    return (s2 / dof) / var;
+}
@@ -0,0 +1,3 @@
+void pdmtheta(double time[], double flux[], double weight[], double freq[],\
+              size_t N, size_t M, int nbins, int covers, double theta[],\
+              int useweight);
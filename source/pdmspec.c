@@ -0,0 +1,212 @@
+/*  ~~~ Time Series Analysis -- Phase Dispersion Minimisation ~~~
+ *
+ * Usage:
+ * pdmspec.x [options] sampling inputfile outputfile
+ *
+ * Sampling: -f {auto | low high rate | list file | around file width rate |
+ *               log low high number}
+ *   auto: Trial frequencies from 5 microHertz to the Nyquist frequency, in
+ *         steps which shift the phase of the last point by at most one
+ *         fine bin (1 / (bins * covers * length of the series)).
+ *   low high rate: Values for sampling in microHz (e.g. "-f 10 200 0.01", to
+ *                  sample from 10 to 200 microHz in steps of 0.01 microHz).
+ *   list file, around file width rate, log low high number: As powerspec.x
+ *                  (frequencies listed in a file, windows around them, or
+ *                  a logarithmic grid).
+ *
+ * The output file contains the trial frequency and the statistic theta of
+ * the phase dispersion minimisation (Stellingwerf 1978): the pooled variance
+ * of the data within the phase bins divided by the total variance. Theta is
+ * close to 1 for noise, and has minima at the period of the signal (and its
+ * multiples). Unlike the power spectrum, it is suited for strongly
+ * non-sinusoidal signals. The lowest theta is reported.
+ *
+ * Options:
+ *  -w: Use weights -- requires an extra column in the input file containing
+ *      weight per data point. The variances are weighted.
+ *  -wscatter number [column], -wsigma: Weights from the scatter in a moving
+ *         window, or from uncertainties in the input file (see powerspec.c).
+ *  -q: Quiet-mode. No output to console.
+ *  -t{sec|day|ms}: Unit of input file (seconds [default], days, megaseconds).
+ *  -noprep: Do not subtract the mean of time series (theta is unaffected,
+ *           but the sums are more accurate with the mean subtracted).
+ *  -fast: Fast-mode. Disable Nyquist calculation (and hence automatic
+ *         sampling) for lower runtime. Activates quiet-mode automatically.
+ *  -bins number: Number of phase bins (default 10).
+ *  -covers number: Number of covers (default 1): sets of bins shifted by
+ *                  1/covers of a bin, which reduce the dependence on the
+ *                  placement of the bins (Stellingwerf uses e.g. 5 bins with
+ *                  2 covers).
+ *
+ * Note:
+ * Using multi-threading with OpenMP. Set number of threads used by the shell
+ * variable "OMP_NUM_THREADS". The trial frequencies are split among the
+ * threads; the data is folded into the phase bins in one pass per frequency
+ * (no sorting).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "fileio.h"
+#include "arrlib.h"
+#include "grid.h"
+#include "pdm.h"
+
+
+int main(int argc, char *argv[])
+{
+    /* Important definitions */
+    // Lengths
+    size_t N = 0;  // Length of time series
+    size_t M = 0;  // Length of sampling vector (number of frequencies)
+
+    // Filenames
+    char inname[100];
+    char outname[100];
+
+    // Sampling
+    double low, high, rate;
+    int freqmode = 0;
+    char listname[100];
+    size_t nlist = 0;
+
+    // Options
+    int quiet = 0;
+    int unit = 1;
+    int prep = 1;
+    int autosamp = 0;
+    int fast = 0;
+    int useweight = 0;
+    int wmode = 0;
+    int wlen = 0;
+    int Nclean = 0;
+    int filter = 0;
+    int nbins = 10;
+    int covers = 1;
+
+
+    /* Process command line arguments and return line count of the input file */
+    N = cmdarg(argc, argv, inname, outname, &quiet, &unit, &prep, &low, &high,\
+               &rate, &autosamp, &fast, &useweight, NULL, NULL, NULL,\
+               &Nclean, &filter, NULL, NULL, NULL, NULL, NULL, NULL, NULL,\
+               NULL, NULL, NULL, &freqmode, listname, &nbins,\
+               &covers, NULL, NULL, NULL, NULL, NULL, &wmode,\
+               &wlen);
+    if ( nbins < 2 ) nbins = 2;
+    if ( covers < 1 ) covers = 1;
+
+    // Pretty print
+    if ( quiet == 0 || fast == 1 ){
+        if ( useweight != 0 )
+            printf("\nPhase dispersion minimisation (weighted) of \"%s\""\
+                   " ...\n", inname);
+        else
+            printf("\nPhase dispersion minimisation of \"%s\" ...\n", inname);
+    }
+
+
+    /* Read data (and weights) from the input file */
+    if ( quiet == 0 ) printf(" - Reading input\n");
+    double* time = malloc(N * sizeof(double));
+    double* flux = malloc(N * sizeof(double));
+    double* weight = malloc(N * sizeof(double));
+    readcols(inname, time, flux, weight, N, useweight, wmode, wlen,\
+             unit, quiet);
+
+    // Do if fast-mode is not activated
+    if ( fast == 0 ) {
+        // Calculate Nyquist frequency
+        double* dt = malloc((N-1) * sizeof(double));
+        double nyquist;
+        arr_diff(time, dt, N);
+        nyquist = 1.0 / (2.0 * arr_median(dt, N-1)) * 1e6; // microHz !
+        free(dt);
+
+        // Suggested sampling (one fine bin of phase over the series)
+        double minsamp;
+        minsamp = 1.0e6 / (nbins * covers * (time[N-1] - time[0]));
+
+        // Display info?
+        if ( quiet == 0 ){
+            printf(" -- INFO: Length of time series = %li\n", N);
+            printf(" -- INFO: Nyquist frequency = %.2lf microHz\n", nyquist);
+            printf(" -- INFO: Suggested minimum sampling = %.3lf microHz\n",\
+                   minsamp);
+        }
+
+        // Apply automatic sampling?
+        if ( autosamp != 0 ) {
+            low = 5.0;
+            high = nyquist;
+            rate = minsamp;
+        }
+    }
+
+    // Subtract the mean (for accurate sums)
+    if ( prep != 0 ) {
+        if ( quiet == 0 ) printf(" - Subtracting the mean from time series\n");
+        arr_sca_add(flux, -arr_mean(flux, N), N);
+    }
+
+
+    /* Trial frequencies */
+    double* freq = freqgrid(freqmode, listname, low, high, rate, 0, &M,\
+                            &nlist);
+    double* theta = malloc(M * sizeof(double));
+
+    // Display info
+    if ( quiet == 0 ){
+        printf(" - Folding the time series\n");
+        if ( freqmode == 1 )
+            printf(" -- INFO: Sampling: The frequencies listed in \"%s\"\n",\
+                   listname);
+        else if ( freqmode == 2 )
+            printf(" -- INFO: Sampling (in microHz): +/- %.2lf around the"\
+                   " %li frequencies listed in \"%s\" in steps of %.4lf\n",\
+                   low, nlist, listname, rate);
+        else if ( freqmode == 3 )
+            printf(" -- INFO: Sampling (in microHz): %.2lf to %.2lf,"\
+                   " logarithmic\n", low, high);
+        else
+            printf(" -- INFO: Sampling (in microHz): %.2lf to %.2lf in"\
+                   " steps of %.4lf\n", low, high, rate);
+        printf(" -- INFO: Number of trial frequencies = %li\n", M);
+        printf(" -- INFO: %i phase bins with %i cover(s)\n", nbins, covers);
+    }
+
+
+    /* Phase dispersion */
+    pdmtheta(time, flux, weight, freq, N, M, nbins, covers, theta, useweight);
+
+    // Lowest theta
+    if ( quiet == 0 && M > 0 ) {
+        size_t jmin = 0;
+        for (size_t j = 1; j < M; ++j) {
+            if ( theta[j] < theta[jmin] ) jmin = j;
+        }
+        printf(" -- INFO: Lowest theta = %.4lf at %.4lf microHz (period"\
+               " %.6lf days)\n", theta[jmin], freq[jmin],\
+               1e6 / freq[jmin] / 86400.0);
+    }
+
+
+    /* Write data to file */
+    if ( quiet == 0 ) printf(" - Saving to file \"%s\"\n", outname);
+    writecols(outname, freq, theta, M);
+
+
+    /* Free data */
+    free(time);
+    free(flux);
+    free(weight);
+    free(freq);
+    free(theta);
+
+
+    /* Done! */
+    if ( quiet == 0 || fast ==1 ) printf("Done!\n\n");
+    return 0;
+}
@@ -0,0 +1,504 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Pipeline of stages (CLEAN, filters, spectra) on a time series in memory
+ *
+ * The stages work in the given order on the same arrays. Products which do
+ * not depend on the changes of the data are shared: the sum of the window
+ * (the times and weights are never changed) is calculated once, and the
+ * last spectrum is reused by later stages on the same frequency grid, as
+ * long as the data has not been changed in between.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "pipeline.h"
+#include "fileio.h"
+#include "arrlib.h"
+#include "tsfourier.h"
+#include "window.h"
+#include "pass.h"
+#include "series.h"
+
+#define PI2micro 6.28318530717958647692528676655900576839433879875e-6
+
+// Max. deviation (in steps) for two frequency grids to be considered equal
+#define PIPEGRIDTOL 1e-6
+
+// Max. number of tokens in a pipeline description
+#define PIPETOKENS 1024
+
+void pipespec(struct pipestate *ps, double f0, size_t M, double alpha[],\
+              double beta[], int quiet);
+
+double pipewinsum(struct pipestate *ps, int quiet);
+
+void pipeband(struct pipestate *ps, double f1, double f2, double result[],\
+              int quiet);
+
+void pipeclean(struct pipestate *ps, int Nclean, char logname[], int quiet);
+
+
+/* Parse a pipeline description
+ *  --> Returns the number of stages (-1 if the description is invalid)
+ *
+ * Stages (one or more, separated by white space):
+ *  - `clean n file`          : CLEAN n frequencies (log in file, or "-")
+ *  - `band f1 f2`            : Bandpass filter between f1 and f2
+ *  - `lowpass f`             : Lowpass filter up to f
+ *  - `highpass f`            : Highpass filter from f
+ *  - `spectrum low high file`: Save the power spectrum from low to high
+ *  - `save file`             : Save the current time series
+ *
+ * Arguments:
+ *  - `ntok`  : Number of tokens
+ *  - `tok`   : Array of tokens (strings)
+ *  - `stages`: OUTPUT -- Array of the stages
+ *  - `Smax`  : Max. number of stages
+ */
+int pipeline_parse(int ntok, char *tok[], struct stage stages[], int Smax)
+{
+    int S = 0;
+    int i = 0;
+    int need;
+    struct stage* st;
+
+    while ( i < ntok ) {
+        if ( S == Smax ) {
+            fprintf(stderr, "Too many stages (max. %i)!\n", Smax);
+            return -1;
+        }
+        st = &stages[S];
+        st->n = 0;
+        st->f1 = 0;
+        st->f2 = 0;
+        strcpy(st->fname, "-");
+
+        // Kind of stage and the number of arguments
+        if ( strcmp(tok[i], "clean") == 0 ) {
+            st->kind = STAGE_CLEAN;
+            need = 2;
+        }
+        else if ( strcmp(tok[i], "band") == 0 ) {
+            st->kind = STAGE_BAND;
+            need = 2;
+        }
+        else if ( strcmp(tok[i], "lowpass") == 0 ) {
+            st->kind = STAGE_LOW;
+            need = 1;
+        }
+        else if ( strcmp(tok[i], "highpass") == 0 ) {
+            st->kind = STAGE_HIGH;
+            need = 1;
+        }
+        else if ( strcmp(tok[i], "spectrum") == 0 ) {
+            st->kind = STAGE_SPECTRUM;
+            need = 3;
+        }
+        else if ( strcmp(tok[i], "save") == 0 ) {
+            st->kind = STAGE_SAVE;
+            need = 1;
+        }
+        else {
+            fprintf(stderr, "Unknown stage \"%s\"!\n", tok[i]);
+            return -1;
+        }
+        if ( i + need >= ntok ) {
+            fprintf(stderr, "Missing arguments for stage \"%s\"!\n", tok[i]);
+            return -1;
+        }
+
+        // Read the arguments
+        if ( st->kind == STAGE_CLEAN ) {
+            st->n = atoi(tok[i+1]);
+            strncpy(st->fname, tok[i+2], 99);
+        }
+        else if ( st->kind == STAGE_BAND ) {
+            st->f1 = atof(tok[i+1]);
+            st->f2 = atof(tok[i+2]);
+        }
+        else if ( st->kind == STAGE_LOW || st->kind == STAGE_HIGH ) {
+            st->f2 = atof(tok[i+1]);
+        }
+        else if ( st->kind == STAGE_SPECTRUM ) {
+            st->f1 = atof(tok[i+1]);
+            st->f2 = atof(tok[i+2]);
+            strncpy(st->fname, tok[i+3], 99);
+        }
+        else {
+            strncpy(st->fname, tok[i+1], 99);
+        }
+        st->fname[99] = '\0';
+
+        i += need + 1;
+        S++;
+    }
+
+    return S;
+}
+
+
+/* Parse a pipeline description given as text (# starts a comment)
+ *  --> Returns the number of stages (-1 if the description is invalid)
+ */
+int pipeline_text(char text[], struct stage stages[], int Smax)
+{
+    char* tok[PIPETOKENS];
+    int ntok = 0;
+
+    // Work on a copy (strtok modifies the string)
+    char* buf = malloc(strlen(text) + 1);
+    strcpy(buf, text);
+
+    // Remove comments
+    char* c = buf;
+    while ( (c = strchr(c, '#')) != NULL ) {
+        while ( *c != '\0' && *c != '\n' ) *c++ = ' ';
+    }
+
+    // Split in tokens
+    char* t = strtok(buf, " \t\r\n");
+    while ( t != NULL && ntok < PIPETOKENS ) {
+        tok[ntok++] = t;
+        t = strtok(NULL, " \t\r\n");
+    }
+
+    int S = pipeline_parse(ntok, tok, stages, Smax);
+    free(buf);
+    return S;
+}
+
+
+/* Read a pipeline description from a file
+ *  --> Returns the number of stages (-1 if the description is invalid)
+ */
+int pipeline_file(char *fname, struct stage stages[], int Smax)
+{
+    FILE* file = fopen(fname, "r");
+    if ( file == NULL ) {
+        fprintf(stderr, "Cannot open the pipeline \"%s\"!\n", fname);
+        return -1;
+    }
+
+    // Read the whole file
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    rewind(file);
+    char* text = malloc(len + 1);
+    size_t got = fread(text, 1, len, file);
+    text[got] = '\0';
+    fclose(file);
+
+    int S = pipeline_text(text, stages, Smax);
+    free(text);
+    return S;
+}
+
+
+/* Prepare the state of the pipeline
+ *  --> The arrays of the time series are used (and changed) in place, and
+ *      are not freed by pipeline_free
+ *
+ * Arguments:
+ *  - `ps`         : OUTPUT -- State of the pipeline
+ *  - `name`       : Name of the time series (for the logs)
+ *  - `time`       : Array of times. In seconds!
+ *  - `flux`       : Array of data.
+ *  - `weight`     : Array of statistical weights.
+ *  - `N`          : Length of the time series
+ *  - `useweight`  : Flag to signal whether to use weights or not (0 = no weights)
+ *  - `unit`       : Unit of the times in the output files (see writecols3)
+ *  - `low`, `high`: Frequency interval for CLEAN and the filters
+ *  - `rate`       : Frequency sampling (of all stages)
+ */
+void pipeline_init(struct pipestate *ps, char name[], double time[],\
+                   double flux[], double weight[], size_t N, int useweight,\
+                   int unit, double low, double high, double rate)
+{
+    strncpy(ps->name, name, 99);
+    ps->name[99] = '\0';
+    ps->time = time;
+    ps->flux = flux;
+    ps->weight = weight;
+    ps->N = N;
+    ps->useweight = useweight;
+    ps->unit = unit;
+    ps->low = low;
+    ps->high = high;
+    ps->rate = rate;
+    ps->havewin = 0;
+    ps->sumwin = 0;
+    ps->version = 0;
+    ps->specversion = -1;
+    ps->spec0 = 0;
+    ps->specM = 0;
+    ps->alpha = NULL;
+    ps->beta = NULL;
+}
+
+
+/* Free the products of the pipeline */
+void pipeline_free(struct pipestate *ps)
+{
+    free(ps->alpha);
+    free(ps->beta);
+    ps->alpha = NULL;
+    ps->beta = NULL;
+    ps->specM = 0;
+}
+
+
+/* Run the stages of the pipeline in order
+ *
+ * Arguments:
+ *  - `ps`    : State of the pipeline (see pipeline_init)
+ *  - `stages`: Array of the stages
+ *  - `S`     : Number of stages
+ *  - `quiet` : Flag. 0 = verbose output. 1 = no output to console
+ */
+void pipeline_run(struct pipestate *ps, struct stage stages[], int S,\
+                  int quiet)
+{
+    size_t N = ps->N;
+    struct stage* st;
+
+    for (int s = 0; s < S; ++s) {
+        st = &stages[s];
+
+        // CLEAN
+        if ( st->kind == STAGE_CLEAN ) {
+            if ( quiet == 0 )
+                printf(" - Stage %i: CLEANing %i frequencies in the range"\
+                       " %.1lf to %.1lf microHz\n", s+1, st->n, ps->low,\
+                       ps->high);
+            pipeclean(ps, st->n, st->fname, quiet);
+        }
+        // Filters -- the data is replaced by the filtered series
+        else if ( st->kind == STAGE_BAND || st->kind == STAGE_LOW ) {
+            double f1 = ( st->kind == STAGE_BAND ) ? st->f1 : ps->rate;
+            if ( quiet == 0 && st->kind == STAGE_BAND )
+                printf(" - Stage %i: Bandpass filter between %.2lf and %.2lf"\
+                       " microHz\n", s+1, f1, st->f2);
+            else if ( quiet == 0 )
+                printf(" - Stage %i: Lowpass filter up to %.2lf microHz\n",\
+                       s+1, st->f2);
+            double* filt = malloc(N * sizeof(double));
+            pipeband(ps, f1, st->f2, filt, quiet);
+            memcpy(ps->flux, filt, N * sizeof(double));
+            ps->version++;
+            free(filt);
+        }
+        else if ( st->kind == STAGE_HIGH ) {
+            if ( quiet == 0 )
+                printf(" - Stage %i: Highpass filter from %.2lf microHz\n",\
+                       s+1, st->f2);
+            double* filt = malloc(N * sizeof(double));
+            pipeband(ps, ps->rate, st->f2, filt, quiet);
+            for (size_t i = 0; i < N; ++i) {
+                ps->flux[i] = ps->flux[i] - filt[i];
+            }
+            ps->version++;
+            free(filt);
+        }
+        // Power spectrum
+        else if ( st->kind == STAGE_SPECTRUM ) {
+            if ( quiet == 0 )
+                printf(" - Stage %i: Power spectrum from %.2lf to %.2lf"\
+                       " microHz\n", s+1, st->f1, st->f2);
+            size_t M = arr_util_getstep(st->f1, st->f2, ps->rate);
+            double* freq = malloc(M * sizeof(double));
+            double* power = malloc(M * sizeof(double));
+            double* alpha = malloc(M * sizeof(double));
+            double* beta = malloc(M * sizeof(double));
+            arr_init_linspace(freq, st->f1, ps->rate, M);
+            pipespec(ps, st->f1, M, alpha, beta, quiet);
+            for (size_t j = 0; j < M; ++j) {
+                power[j] = alpha[j]*alpha[j] + beta[j]*beta[j];
+            }
+            if ( quiet == 0 ) printf(" -- INFO: Saving to \"%s\"\n", st->fname);
+            writecols(st->fname, freq, power, M);
+            free(freq);
+            free(power);
+            free(alpha);
+            free(beta);
+        }
+        // Time series
+        else if ( st->kind == STAGE_SAVE ) {
+            if ( quiet == 0 )
+                printf(" - Stage %i: Saving the time series to \"%s\"\n",\
+                       s+1, st->fname);
+            writecols3(st->fname, ps->time, ps->flux, ps->weight, N,\
+                       ps->useweight, ps->unit);
+        }
+    }
+}
+
+
+/* Spectrum (alpha and beta) of the current data at f0 + k*rate, k < M
+ *  --> Reuses the last spectrum if the data is unchanged and the grid is
+ *      contained in it. Otherwise it is calculated (of the data with the
+ *      mean subtracted) and kept for later stages.
+ */
+void pipespec(struct pipestate *ps, double f0, size_t M, double alpha[],\
+              double beta[], int quiet)
+{
+    size_t N = ps->N;
+
+    // Reuse the last spectrum?
+    if ( ps->specversion == ps->version && ps->specM > 0 ) {
+        double k = (f0 - ps->spec0) / ps->rate;
+        double k0 = round(k);
+        if ( fabs(k - k0) < PIPEGRIDTOL && k0 >= 0 &&\
+             (size_t) k0 + M <= ps->specM ) {
+            memcpy(alpha, &ps->alpha[(size_t) k0], M * sizeof(double));
+            memcpy(beta, &ps->beta[(size_t) k0], M * sizeof(double));
+            if ( quiet == 0 )
+                printf(" -- INFO: Spectrum reused from an earlier stage\n");
+            return;
+        }
+    }
+
+    // Data with the mean subtracted
+    double* x = malloc(N * sizeof(double));
+    double fmean = arr_mean(ps->flux, N);
+    for (size_t i = 0; i < N; ++i) {
+        x[i] = ps->flux[i] - fmean;
+    }
+
+    // Calculate the spectrum
+    if ( quiet == 0 )
+        printf(" -- INFO: Number of sampling frequencies = %li\n", M);
+    double* freq = malloc(M * sizeof(double));
+    double* power = malloc(M * sizeof(double));
+    arr_init_linspace(freq, f0, ps->rate, M);
+    fourier(ps->time, x, ps->weight, freq, N, M, power, alpha, beta,\
+            ps->useweight);
+
+    // Keep it for the following stages
+    free(ps->alpha);
+    free(ps->beta);
+    ps->alpha = malloc(M * sizeof(double));
+    ps->beta = malloc(M * sizeof(double));
+    memcpy(ps->alpha, alpha, M * sizeof(double));
+    memcpy(ps->beta, beta, M * sizeof(double));
+    ps->spec0 = f0;
+    ps->specM = M;
+    ps->specversion = ps->version;
+
+    free(x);
+    free(freq);
+    free(power);
+}
+
+
+/* Sum of the window at the centre of the sampling (calculated once) */
+double pipewinsum(struct pipestate *ps, int quiet)
+{
+    if ( ps->havewin == 0 ) {
+        double fwin = (ps->low + ps->high)/2.0;
+        ps->sumwin = windowsum(fwin, ps->low, ps->high, ps->rate, ps->time,\
+                               ps->weight, ps->N, ps->useweight, quiet);
+        ps->havewin = 1;
+    }
+    else if ( quiet == 0 ) {
+        printf(" -- INFO: Sum of the window reused from an earlier stage\n");
+    }
+    return ps->sumwin;
+}
+
+
+/* Bandpass filtered series of the current data (see bandpass in pass.c) */
+void pipeband(struct pipestate *ps, double f1, double f2, double result[],\
+              int quiet)
+{
+    size_t N = ps->N;
+    double sumwin = pipewinsum(ps, quiet);
+
+    // Spectrum of the band
+    size_t M = arr_util_getstep(f1, f2, ps->rate);
+    double* freq = malloc(M * sizeof(double));
+    double* alpha = malloc(M * sizeof(double));
+    double* beta = malloc(M * sizeof(double));
+    arr_init_linspace(freq, f1, ps->rate, M);
+    pipespec(ps, f1, M, alpha, beta, quiet);
+
+    // Generate the new time series (with the mean added again)
+    bandseries(ps->time, N, freq, M, alpha, beta, sumwin, result);
+    arr_sca_add(result, arr_mean(ps->flux, N), N);
+
+    free(freq);
+    free(alpha);
+    free(beta);
+}
+
+
+/* CLEAN the current data (see fclean.c) */
+void pipeclean(struct pipestate *ps, int Nclean, char logname[], int quiet)
+{
+    size_t N = ps->N;
+    double* time = ps->time;
+    double* flux = ps->flux;
+    double fmax, alpmax, betmax, powmax;
+
+    // Sampling
+    size_t M = arr_util_getstep(ps->low, ps->high, ps->rate);
+    double* freq = malloc(M * sizeof(double));
+    arr_init_linspace(freq, ps->low, ps->rate, M);
+    if ( quiet == 0 )
+        printf(" -- INFO: Number of sampling frequencies = %li\n", M);
+
+    // Subtract the mean
+    double fmean = arr_mean(flux, N);
+    arr_sca_add(flux, -fmean, N);
+
+    // Log of the CLEAN
+    FILE* logfile = NULL;
+    if ( strcmp(logname, "-") != 0 ) {
+        logfile = fopen(logname, "w");
+        fprintf(logfile, "# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~"\
+                "~~~~~~~~~~~~~~\n");
+        fprintf(logfile, "# Log of CLEAN on \"%s\"\n", ps->name);
+        fprintf(logfile, "# Interval: [%.2lf, %.2lf] microHz\n", ps->low,\
+                ps->high);
+        fprintf(logfile, "# Finding %i frequencies\n", Nclean);
+        fprintf(logfile, "# \n");
+        fprintf(logfile, "# %8s %11s %11s %12s %12s\n", "Number", "Frequency",\
+                "Power", "Alpha", "Beta");
+        fprintf(logfile, "# ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~"\
+                "~~~~~~~~~~~~~~\n");
+    }
+    if ( quiet == 0 )
+        printf("\n %9s %11s %11s\n", "Number", "Frequency", "Power");
+
+    // CLEAN-loop (on a prepared series)
+    struct series* ser = series_prepare(time, flux, ps->weight, N,\
+                                        ps->useweight);
+    for (int i = 0; i < Nclean; ++i) {
+        fmax = 0;
+        alpmax = 0;
+        betmax = 0;
+        fouriermax_series(ser, freq, M, &fmax, &alpmax, &betmax);
+
+        powmax = alpmax*alpmax + betmax*betmax;
+        if ( logfile != NULL )
+            fprintf(logfile, " %6i %15.6lf %12.6lg %12.6lf %12.6lf\n", i+1,\
+                    fmax, powmax, alpmax, betmax);
+        if ( quiet == 0 )
+            printf(" %6i %15.6lf %12.6lg \n", i+1, fmax, powmax);
+
+        // Remove frequency from time series
+        series_subtract(ser, PI2micro*fmax, alpmax, betmax);
+    }
+    memcpy(flux, ser->flux, N * sizeof(double));
+    series_free(ser);
+    if ( quiet == 0 ) printf("\n");
+    if ( logfile != NULL ) fclose(logfile);
+
+    // Add the mean again
+    arr_sca_add(flux, fmean, N);
+    ps->version++;
+    free(freq);
+}
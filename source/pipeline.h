@@ -0,0 +1,63 @@
+// Kinds of stages
+#define STAGE_CLEAN 1
+#define STAGE_BAND 2
+#define STAGE_LOW 3
+#define STAGE_HIGH 4
+#define STAGE_SPECTRUM 5
+#define STAGE_SAVE 6
+
+// Max. number of stages in a pipeline
+#define STAGEMAX 64
+
+// A stage of the pipeline
+struct stage {
+    int kind;
+    int n;            // Number of frequencies to CLEAN
+    double f1;        // Frequency limits (in microHz)
+    double f2;
+    char fname[100];  // Output file ("-" for none)
+};
+
+// The time series and the products shared between the stages
+struct pipestate {
+    // Time series
+    char name[100];
+    double* time;
+    double* flux;
+    double* weight;
+    size_t N;
+    int useweight;
+    int unit;
+
+    // Sampling
+    double low;
+    double high;
+    double rate;
+
+    // Sum of the window (calculated once -- the times are never changed)
+    int havewin;
+    double sumwin;
+
+    // Last spectrum (alpha and beta), valid while the data is unchanged
+    long version;
+    long specversion;
+    double spec0;
+    size_t specM;
+    double* alpha;
+    double* beta;
+};
+
+int pipeline_parse(int ntok, char *tok[], struct stage stages[], int Smax);
+
+int pipeline_text(char text[], struct stage stages[], int Smax);
+
+int pipeline_file(char *fname, struct stage stages[], int Smax);
+
+void pipeline_init(struct pipestate *ps, char name[], double time[],\
+                   double flux[], double weight[], size_t N, int useweight,\
+                   int unit, double low, double high, double rate);
+
+void pipeline_run(struct pipestate *ps, struct stage stages[], int S,\
+                  int quiet);
+
+void pipeline_free(struct pipestate *ps);
@@ -3,19 +3,34 @@
  * Usage:
  * powerspec.x [options] sampling inputfile outputfile
  *
- * Sampling: -f {auto | low high rate | limit rate}
+ * Sampling: -f {auto | low high rate | limit rate | list file |
+ *               around file width rate | log low high number}
  *   auto: Calculate power spectrum from 5 microHertz to Nyquist frequency
  *         with four times oversampling (auto is a key word, use as "-f auto").
  *   low high rate: Values for sampling in microHz (e.g. "-f 1500 4000 0.1", to
  *                  sample from 1500 to 4000 microHz in steps of 0.1 microHz).
  *   limit rate: ONLY IN THE CASE OF window-function-mode. Sample the window
  *               function in the range +/- limit in steps of rate.
+ *   list file: Only the frequencies (in microHz) in the first column of the
+ *              file, in the given order (e.g. known mode frequencies).
+ *   around file width rate: Windows of +/- width around each frequency in
+ *                           the file, in steps of rate (overlapping windows
+ *                           are merged). All in microHz.
+ *   log low high number: `number` frequencies from low to high (both > 0),
+ *                        equidistant in the logarithm of the frequency.
+ *   Only the given frequencies are calculated. With a list or a logarithmic
+ *   grid, the engine "auto" uses the direct sums (the other engines need
+ *   equidistant frequencies).
  *
  * Special options:
  *  -window f0: Activate window-function-mode. Calculate the (power spectrum of)
  *              the window function at frequency f0 (in microHertz). Uses the
  *              provided input times and weights, as well as the provided
  *              frequency sampling.
+ *              Several frequencies can be given as a comma-separated list
+ *              (e.g. "-window 1000,2500,4000", at most 64). All windows are
+ *              calculated in one pass over the times, and written as a
+ *              table: the frequency relative to f0 and one column per f0.
  *              NOTE: Remember to specify the frequency f0! Unit is microHertz.
  *              NOTE 2: Remember to specify a correct sampling (see above).
  *              NOTE 3: This switch will *not* produce a power spectrum of the
@@ -24,10 +39,21 @@
  *                      since the input data is not used (only the times).
  *              NOTE 5: Will activate pseudo fast-mode and hence disable
  *                      automatic sampling and Nyquist calculation.
+ *              NOTE 6: If the times lie exactly on a regular cadence (gaps
+ *                      are fine), the window is calculated using FFTs of the
+ *                      sampling (the same result as the direct sums).
 
  * Options:
  *  -w: Calculate weighted power spectrum -- requires an extra column in the
  *      input file containing weight per data point.
+ *  -wscatter number [column]: Weights from the local scatter, calculated
+ *         while reading the input (no file with weights needed): 1 / the
+ *         variance of the data in a moving window of the last `number`
+ *         points (e.g. 50-100). With "column", the variance of an extra
+ *         column in the input file (e.g. the residuals of a high-pass
+ *         filter) is used instead of the data. Implies -w.
+ *  -wsigma: Weights 1 / sigma^2 from the uncertainties sigma in an extra
+ *         column of the input file. Implies -w.
  *  -q: Quiet-mode. No output to console.
  *  -t{sec|day|ms}: Unit of input file (seconds [default], days, megaseconds).
  *  -noprep: Do not subtract the mean of time series (for artificial data where
@@ -35,16 +61,111 @@
  *  -fast: Fast-mode. Disable Nyquist calculation (and hence automatic
  *         sampling) for lower runtime. Activates quiet-mode automatically. Use
  *         for benchmarking the pure I/O + algorithm.
+ *  -bin margin: Bin the time series before the calculation (weighted means
+ *               of times and data, skipping gaps). The bins are as long as
+ *               possible while keeping the Nyquist frequency of the binned
+ *               series `margin` (> 1) times above the highest frequency. The
+ *               attenuation of the amplitude is reported. Without weights,
+ *               the number of points per bin is used as weights.
+ *  -engine {auto|tune|direct|fft|zoom|float}: Engine for the power spectrum.
+ *         auto [default]: Choose the fastest of direct, fft and zoom from
+ *              a cost model (length of the series, number of frequencies,
+ *              cadence, width of the band and number of threads). Its
+ *              coefficients are read from the tuning file $TSA_TUNING (or
+ *              "tsa/tuning.txt" in the user cache, $XDG_CACHE_HOME or
+ *              ~/.cache) if it exists, otherwise built-in values are used.
+ *              The choice and the estimates are reported. Engines the
+ *              sampling does not allow are never chosen.
+ *         tune: As auto, but first measure the coefficients on this machine
+ *               and write them to the tuning file (used by later runs with
+ *               auto).
+ *         direct: Direct least-squares sums for every frequency.
+ *         fft: If all times are integer multiples of a cadence (gaps are
+ *              fine), the identical sums are calculated from FFTs (chirp-z
+ *              transforms) of the zero-filled series on the cadence grid.
+ *              Falls back to direct for irregular sampling.
+ *         zoom: For narrow bands far from zero. The series is mixed down by
+ *               the centre of the band and decimated to a short, complex
+ *               series (with exact corrections for the phase within each
+ *               bin), of which the spectrum is calculated. Any sampling.
+ *               Falls back to fft/direct if the band is too wide.
+ *         float: Direct sums with single-precision sin/cos (accumulated in
+ *                double precision). The times are centred around the middle
+ *                of the series to keep the phases accurate. Also used for
+ *                the window function.
+ *
+ *  -checkpoint seconds: Save the completed frequencies to the checkpoint
+ *         "outputfile.ckpt" at most every `seconds` (the frequencies are
+ *         calculated in parts of 1/64). A restarted run with the same input,
+ *         options and output file continues from the checkpoint. The
+ *         checkpoint is removed when the output is written. The FFT and
+ *         zoom engines transform the whole grid in every call, so they
+ *         calculate all frequencies at once (they are fast, and the automatic
+ *         choice is made for the size of the parts).
+ *
+ *  -falarm number {shuffle|noise}: False-alarm probabilities from `number`
+ *         randomised realisations of the data: the flux is shuffled among
+ *         the times, or replaced by Gaussian noise with the same scatter
+ *         (scaled by 1/sqrt(weight) with weights). The output file gets a
+ *         third column with the false-alarm probability per frequency, and
+ *         "outputfile.maxdist" the sorted max. powers of the realisations
+ *         (the distribution of the highest peak). The realisations share the
+ *         sin/cos of the direct sums (the engine and -trig are not used),
+ *         and are reproducible. Not with -window or -checkpoint.
+ *
+ *  -harmonics K: Fit K harmonics (1 to 16) of every frequency simultaneously,
+ *         for non-sinusoidal signals (eclipsing binaries, RR Lyrae etc.).
+ *         The power is the sum of the squared amplitudes of all harmonics
+ *         (K = 1 is the normal spectrum). Uses direct sums, where only the
+ *         sin/cos of the fundamental are evaluated (the harmonics follow
+ *         from a recurrence); the engine and -trig are not used. Not with
+ *         -window or -falarm.
+ *
+ *  -trig {exact|1e-10|1e-6}: Accuracy of sin/cos in the direct sums.
+ *         exact [default]: Using the C library.
+ *         1e-10, 1e-6: Phases are accumulated along the (equidistant)
+ *                      frequencies as exact fixed-point fractions of a turn,
+ *                      and sin/cos are taken from a small table with a
+ *                      polynomial correction. The measured max. error of the
+ *                      table is reported. Trades precision for throughput.
+ *
+ *  -numa: For nodes with several sockets (NUMA). The threads are pinned to
+ *         the cores (thread t on the t-th allowed core), the data is copied
+ *         to the memory of every node used by the threads, and the results
+ *         are first written by the thread which calculates them. Without
+ *         this, all threads read the data from the memory of the socket
+ *         which read the input file. Only used by the direct sums over the
+ *         frequencies (engine direct, or auto when it chooses them); the
+ *         spectrum is unchanged. Off by default; measure the gain on the
+ *         node with "make bench" before using it.
+ *
+ *  -pyramid factor: Also write "outputfile.pyr", a binary file with the
+ *         spectrum at several resolutions for fast browsing: level 0 is the
+ *         full spectrum, and each level pools `factor` records of the one
+ *         below (max. power with its frequency, and mean power) until one
+ *         record is left. An index of the levels is at the start of the
+ *         file, so any level over any range is a single read (format in
+ *         pyramid.c). The levels are built as the parts of the calculation
+ *         finish (see -checkpoint), with a small buffer per level; the
+ *         calculation itself is not split for the pyramid. Not with several
+ *         windows.
  *
  * Note:
  * Using multi-threading with OpenMP. Set number of threads used by the shell
  * variable "OMP_NUM_THREADS".
  *
+ * MPI: "make mpi" builds powerspec_mpi.x, which distributes the frequencies
+ * over several processes (each using OpenMP), e.g.
+ *   OMP_NUM_THREADS=4 mpirun -n 2 ./powerspec_mpi.x -f auto in.txt out.txt
+ * The input is read by the first process and broadcasted; the spectrum is
+ * gathered and written by the first process.
+ *
  * Author: Jakob Rørsted Mosumgaard
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <math.h>
 #include <omp.h>
 
@@ -52,6 +173,16 @@
 #include "arrlib.h"
 #include "tsfourier.h"
 #include "window.h"
+#include "preproc.h"
+#include "dist.h"
+#include "checkpoint.h"
+#include "falarm.h"
+#include "harmonic.h"
+#include "tune.h"
+#include "series.h"
+#include "grid.h"
+#include "numa.h"
+#include "pyramid.h"
 
 
 int main(int argc, char *argv[])
@@ -67,9 +198,13 @@ int main(int argc, char *argv[])
 
     // Sampling
     double low, high, rate;
+    int freqmode = 0;
+    char listname[100];
+    size_t nlist = 0;
 
-    // Frequency of window function
-    double winfreq = 0;
+    // Frequencies of window functions
+    double winfreq[64];
+    size_t nwin = 0;
 
     // Options
     int quiet = 0;
@@ -78,15 +213,63 @@ int main(int argc, char *argv[])
     int autosamp = 0;
     int fast = 0;
     int useweight = 0;
+    int wmode = 0;
+    int wlen = 0;
     int windowmode = 0;
     int Nclean = 0;
     int filter = 0;
+    int engine = 0;
+    double binmargin = 0;
+    int trig = 0;
+    double ckpt = -1;
+    int nreal = 0;
+    int famode = 0;
+    int harmonics = 1;
+    int numa = 0;
+    int pyramid = 0;
+
+    // Processes (MPI)
+    int nproc = 1;
+    int rank = dist_init(&argc, &argv, &nproc);
+    size_t lo, cnt;
 
     
     /* Process command line arguments and return line count of the input file */
     N = cmdarg(argc, argv, inname, outname, &quiet, &unit, &prep, &low, &high,\
-               &rate, &autosamp, &fast, &useweight, &windowmode, &winfreq,\
-               &Nclean, &filter, NULL, NULL);
+               &rate, &autosamp, &fast, &useweight, &windowmode, winfreq,\
+               &nwin, &Nclean, &filter, NULL, NULL, NULL, &engine,\
+               &binmargin, &trig, &ckpt, &nreal, &famode,\
+               &harmonics, &freqmode, listname, NULL, NULL, NULL, NULL,\
+               NULL, &numa, &pyramid, &wmode, &wlen);
+    int measure = ( engine == 5 );  // -engine tune
+    if ( measure != 0 ) engine = 0;
+    fourier_setengine(engine);
+    double trigerr = fourier_settrig(trig);
+    if ( windowmode != 0 ) nreal = 0;
+    if ( nreal > 0 || nwin > 1 ) ckpt = -1;
+    if ( windowmode != 0 ) harmonics = 1;
+    if ( harmonics > 1 && nreal > 0 ) {
+        fprintf(stderr, "Cannot combine -harmonics and -falarm! Quitting!\n");
+        exit(1);
+    }
+    if ( pyramid != 0 && (pyramid < 2 || nwin > 1) ) {
+        fprintf(stderr, "Pyramid needs a factor > 1 and one spectrum!"\
+                " Quitting!\n");
+        exit(1);
+    }
+
+    // Name of the checkpoint (one per process)
+    char ckptname[120];
+    if ( nproc > 1 )
+        snprintf(ckptname, sizeof(ckptname), "%s.ckpt%i", outname, rank);
+    else
+        snprintf(ckptname, sizeof(ckptname), "%s.ckpt", outname);
+
+    // Only the first process talks
+    if ( rank != 0 ) {
+        quiet = 1;
+        fast = 0;
+    }
     
     // Pretty print
     if ( quiet == 0 || fast == 1 ){
@@ -100,17 +283,26 @@ int main(int argc, char *argv[])
     }
     
 
+    // Pin the threads to the cores (before any data is placed)
+    if ( numa != 0 ) numa_pin(quiet);
+
+
     /* Read data (and weights) from the input file */
     if ( quiet == 0 ) printf(" - Reading input\n");
     double* time = malloc(N * sizeof(double));
     double* flux = malloc(N * sizeof(double));
     double* weight = malloc(N * sizeof(double));
-    readcols(inname, time, flux, weight, N, useweight, unit, quiet);
+    if ( rank == 0 )
+        readcols(inname, time, flux, weight, N, useweight, wmode, wlen,\
+                 unit, quiet);
+    dist_bcast(time, N);
+    dist_bcast(flux, N);
+    if ( useweight != 0 ) dist_bcast(weight, N);
     
     // Do if fast-mode and window-mode is not activated
     if ( fast == 0 && windowmode == 0 ) {
         // Calculate Nyquist frequency
-        double* dt = malloc(N-1 * sizeof(double));
+        double* dt = malloc((N-1) * sizeof(double));
         double nyquist;
         arr_diff(time, dt, N);
         nyquist = 1.0 / (2.0 * arr_median(dt, N-1)) * 1e6; // microHz !
@@ -140,24 +332,38 @@ int main(int argc, char *argv[])
     /* Prepare for power spectrum */
     // Calculate proper frequency range for window-function-mode
     double limit = 0;
+    double fbin = high;
     if ( windowmode != 0 ) {
         limit = low;
-        low = winfreq - limit;
-        high = winfreq + limit;
+        low = winfreq[0] - limit;
+        high = winfreq[0] + limit;
+        fbin = arr_max(winfreq, nwin) + limit;
+
+        // Several windows: Offsets common to all f0
+        if ( nwin > 1 ) {
+            low = -limit;
+            high = limit;
+        }
     }
-    
-    // Get length of sampling vector
-    M = arr_util_getstep(low, high, rate);
 
-    // Fill sampling vector with cyclic frequencies
-    double* freq = malloc(M * sizeof(double));
-    arr_init_linspace(freq, low, rate, M);
+    // Get length of sampling vector and fill it with cyclic frequencies
+    double* freq = freqgrid(freqmode, listname, low, high, rate, rank, &M,\
+                            &nlist);
+    if ( freqmode != 0 ) fbin = arr_max(freq, M);
+
+    // Bin the time series? (up to the highest frequency of all windows)
+    if ( binmargin > 0 ) {
+        N = binning(time, flux, weight, N, fbin, binmargin, &useweight, quiet);
+    }
 
     // Initialise arrays for data storage
     double* power = malloc(M * sizeof(double));
     double* alpha = malloc(M * sizeof(double));
     double* beta = malloc(M * sizeof(double));
 
+    // Slice of the frequencies calculated by this process
+    dist_range(M, 0, &lo, &cnt);
+
 
     /* Calculate power spectrum OR window function */
     if ( windowmode == 0 ) {
@@ -181,39 +387,237 @@ int main(int argc, char *argv[])
                 printf(" -- INFO: Auto-sampling (in microHz): %.2lf to %.2lf"\
                        " in steps of %.4lf\n", low, high, rate);
             }
+            else if ( freqmode == 1 ) {
+                printf(" -- INFO: Sampling: The frequencies listed in"\
+                       " \"%s\"\n", listname);
+            }
+            else if ( freqmode == 2 ) {
+                printf(" -- INFO: Sampling (in microHz): +/- %.2lf around the"\
+                       " %li frequencies listed in \"%s\" in steps of %.4lf\n",\
+                       low, nlist, listname, rate);
+            }
+            else if ( freqmode == 3 ) {
+                printf(" -- INFO: Sampling (in microHz): %.2lf to %.2lf,"\
+                       " logarithmic\n", low, high);
+            }
             else {
                 printf(" -- INFO: Sampling (in microHz): %.2lf to %.2lf in"\
                        " steps of %.4lf\n", low, high, rate);
             }
             printf(" -- INFO: Number of sampling frequencies = %li\n", M);
+            if ( nproc > 1 )
+                printf(" -- INFO: Frequencies distributed over %i processes\n",\
+                       nproc);
+            if ( trig != 0 && nreal == 0 )
+                printf(" -- INFO: Table-driven sin/cos with max. error"\
+                       " %.2le\n", trigerr);
+            if ( harmonics > 1 )
+                printf(" -- INFO: Fitting %i harmonics at every frequency\n",\
+                       harmonics);
+            if ( nreal > 0 )
+                printf(" -- INFO: False-alarm probabilities from %i %s"\
+                       " realisations\n", nreal,\
+                       ( famode == 1 ) ? "shuffled" : "noise");
         }
-
-        // Calculate power spectrum with or without weights
-        fourier(time, flux, weight, freq, N, M, power, alpha, beta, useweight);
     }
     else {
         if ( quiet == 0 ){
             printf(" - Calculating window function\n");
-            printf(" -- INFO: Window frequency = %.2lf microHz\n", winfreq);
+            for (size_t k = 0; k < nwin; ++k) {
+                printf(" -- INFO: Window frequency = %.2lf microHz\n",\
+                       winfreq[k]);
+            }
             printf(" -- INFO: Sampling in the range +/- %.2lf microHz in" \
                    " steps of %.4lf microHz\n", limit, rate);
             printf(" -- INFO: Number of sampling frequencies = %li\n", M);
+            if ( nproc > 1 )
+                printf(" -- INFO: Frequencies distributed over %i processes\n",\
+                       nproc);
+        }
+    }
+
+    // False-alarm probabilities (with the power spectrum of the data)
+    double* fap = NULL;
+    double* maxpow = NULL;
+    if ( nreal > 0 ) {
+        fap = malloc(M * sizeof(double));
+        maxpow = malloc(nreal * sizeof(double));
+        falsealarm(time, flux, weight, &freq[lo], N, cnt, nreal, famode,\
+                   useweight, &power[lo], &fap[lo], maxpow);
+        dist_gather(fap, M);
+        dist_max(maxpow, nreal);
+    }
+
+    // Prepared series shared by the spectrum and the window (see series.c)
+    struct series* ser = series_prepare(time, flux, weight, N, useweight);
+
+    // Several windows (in one pass, with the frequencies relative to f0)
+    double* windows = NULL;
+    if ( nwin > 1 ) {
+        windows = malloc(nwin * M * sizeof(double));
+        double* part = malloc(nwin * cnt * sizeof(double));
+        windowmulti_series(ser, &freq[lo], cnt, winfreq, nwin, part);
+        for (size_t k = 0; k < nwin; ++k) {
+            for (size_t j = 0; j < cnt; ++j) {
+                windows[k*M + lo + j] = part[k*cnt + j];
+            }
+            dist_gather(&windows[k*M], M);
+        }
+        free(part);
+    }
+
+    // Frequencies per call of the engine (parts between the checkpoints)
+    size_t part = ( ckpt >= 0 ) ? ckpt_part(cnt) : cnt;
+
+    // Choose the engine (on the first process), for the size of the parts
+    if ( engine == 0 && windowmode == 0 && harmonics == 1 && nreal == 0 &&\
+         freqmode == 0 ) {
+        double choice = 0;
+        if ( rank == 0 ) choice = tune_engine(time, N, freq[lo], rate, part,\
+                                              measure, quiet);
+        dist_bcast(&choice, 1);
+        engine = choice;
+        fourier_setengine(engine);
+    }
+
+    // The FFT and zoom engines transform the whole grid (or mix down the
+    // whole series) in every call: One call for all frequencies
+    if ( harmonics == 1 && part < cnt && ( engine == 3 ||\
+         ( (engine == 0 || engine == 2) && fourier_fftgrid(time, N, cnt) ) ) ) {
+        part = cnt;
+        if ( quiet == 0 && ckpt >= 0 )
+            printf(" -- INFO: The FFT and zoom engines calculate all"\
+                   " frequencies at once (no checkpoints)\n");
+    }
+
+    // Resume from a checkpoint of the same data and sampling?
+    size_t done = 0;
+    uint64_t key = 0;
+    if ( ckpt >= 0 ) {
+        double param[10] = {freq[lo], rate, cnt, windowmode, winfreq[0],\
+                            engine, trig, harmonics, freqmode,\
+                            arr_sum(&freq[lo], cnt)};
+        key = ckpt_key(time, flux, weight, N, param, 10, useweight);
+        done = ckpt_load(ckptname, key, &power[lo], cnt);
+        if ( quiet == 0 && done > 0 )
+            printf(" -- INFO: Resuming from checkpoint with %li of %li"\
+                   " frequencies done\n", done, cnt);
+    }
+
+    // Pyramid of the spectrum: Built from the parts of the calculation as
+    // they finish (one process), otherwise from the final spectrum
+    char pyrname[120];
+    struct pyramid* pyr = NULL;
+    int pyrstream = ( nproc == 1 && windowmode == 0 && nreal == 0 );
+    snprintf(pyrname, sizeof(pyrname), "%s.pyr", outname);
+    if ( pyramid != 0 && pyrstream ) {
+        pyr = pyr_open(pyrname, M, pyramid);
+        pyr_push(pyr, freq, power, done);
+    }
+
+    // Calculate power spectrum or spectral window with or without weights
+    //  --> In parts between the checkpoints
+    double lastckpt = omp_get_wtime();
+    if ( nreal > 0 || nwin > 1 ) done = cnt;
+    if ( numa != 0 ) {
+        // Copies of the data per node, and the pages of the results placed
+        // by the threads which calculate them (same parts and partition)
+        series_replicate(ser);
+        for (size_t j = lo + done; j < lo + cnt; j += part) {
+            size_t n = ( lo + cnt - j < part ) ? lo + cnt - j : part;
+            numa_firsttouch(&power[j], n);
+            numa_firsttouch(&alpha[j], n);
+            numa_firsttouch(&beta[j], n);
         }
+    }
+    for (size_t j = lo + done; j < lo + cnt; j += part) {
+        size_t n = ( lo + cnt - j < part ) ? lo + cnt - j : part;
+        if ( harmonics > 1 )
+            fourierharm(time, flux, weight, &freq[j], N, n, harmonics,\
+                        &power[j], &alpha[j], &beta[j], useweight);
+        else if ( windowmode == 0 )
+            fourier_series(ser, &freq[j], n, &power[j], &alpha[j], &beta[j]);
+        else
+            windowfunction_series(ser, &freq[j], n, winfreq[0], &power[j]);
+        pyr_push(pyr, &freq[j], &power[j], n);
 
-        // Calculate spectral window with or without weights
-        windowfunction(time, freq, weight, N, M, winfreq, power, useweight);
+        if ( ckpt >= 0 && j + n < lo + cnt &&\
+             omp_get_wtime() - lastckpt >= ckpt ) {
+            ckpt_save(ckptname, key, &power[lo], j + n - lo);
+            lastckpt = omp_get_wtime();
+        }
+    }
+    series_free(ser);
+    dist_gather(power, M);
 
+    // Window: Sum and frequencies relative to f0
+    if ( windowmode != 0 && nwin == 1 ) {
         if ( quiet == 0 )
             printf(" - Sum of spectral window = %.4lf\n", arr_sum(power, M));
 
         // Move frequencies to the origin
-        arr_sca_add(freq, -winfreq, M);
+        arr_sca_add(freq, -winfreq[0], M);
+    }
+    else if ( nwin > 1 && quiet == 0 ) {
+        for (size_t k = 0; k < nwin; ++k) {
+            printf(" - Sum of spectral window at %.2lf microHz = %.4lf\n",\
+                   winfreq[k], arr_sum(&windows[k*M], M));
+        }
     }
 
         
     /* Write data to file */
     if ( quiet == 0 ) printf(" - Saving to file \"%s\"\n", outname);
-    writecols(outname, freq, power, M);
+    if ( rank == 0 && nwin > 1 )
+        writecolsN(outname, freq, windows, NULL, M, nwin, 0, 1);
+    else if ( rank == 0 && nreal == 0 )
+        writecols(outname, freq, power, M);
+    free(windows);
+
+    // Pyramid (finish or build from the spectrum)
+    if ( pyramid != 0 && rank == 0 ) {
+        if ( quiet == 0 ) printf(" - Saving the pyramid (factor %i) to"\
+                                 " \"%s\"\n", pyramid, pyrname);
+        if ( pyrstream == 0 ) {
+            pyr = pyr_open(pyrname, M, pyramid);
+            pyr_push(pyr, freq, power, M);
+        }
+        pyr_close(pyr);
+    }
+
+    // With false-alarm probabilities: Third column and the distribution of
+    // the highest peak
+    if ( nreal > 0 ) {
+        char maxname[120];
+        snprintf(maxname, sizeof(maxname), "%s.maxdist", outname);
+        arr_sort(maxpow, nreal);
+
+        if ( quiet == 0 ) {
+            double pmax = arr_max(power, M);
+            size_t above = 0;
+            for (int r = 0; r < nreal; ++r) {
+                if ( maxpow[r] >= pmax ) above++;
+            }
+            printf(" -- INFO: False-alarm probability of the highest peak"\
+                   " = %.4lf\n", (1.0 + above) / (nreal + 1.0));
+            printf(" - Saving the max. powers to \"%s\"\n", maxname);
+        }
+        if ( rank == 0 ) {
+            writecols3(outname, freq, power, fap, M, 1, 1);
+            FILE* maxfile = fopen(maxname, "w");
+            if ( maxfile != NULL ) {
+                for (int r = 0; r < nreal; ++r) {
+                    fprintf(maxfile, "%18.9e\n", maxpow[r]);
+                }
+                fclose(maxfile);
+            }
+        }
+        free(fap);
+        free(maxpow);
+    }
+
+    // The checkpoint is no longer needed
+    if ( ckpt >= 0 ) remove(ckptname);
 
     
     /* Free data */
@@ -227,6 +631,8 @@ int main(int argc, char *argv[])
 
 
     /* Done! */
+    dist_finalize();
     if ( quiet == 0 || fast ==1 ) printf("Done!\n\n");
     return 0; 
 }
+
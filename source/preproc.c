@@ -0,0 +1,143 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Routines for preprocessing of time series
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "arrlib.h"
+
+#define PI 3.14159265358979323846264338327950288419716939937
+
+
+/* Bin the time series (IN-PLACE)
+ *  --> Returns the new length of the time series
+ *
+ * The bins have a fixed length starting from the first time. Each bin is
+ * replaced by the weighted mean of the times and the data, and the sum of
+ * the weights (the number of points if no weights are used). Empty bins --
+ * gaps in the data -- are skipped.
+ *
+ * Arguments:
+ *  - `time`     : Array of times (ascending). In seconds!
+ *  - `flux`     : Array of data.
+ *  - `weight`   : Array of statistical weights. OUTPUT -- Weights of the bins.
+ *  - `N`        : Length of the time series
+ *  - `tbin`     : Length of the bins (in seconds)
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ */
+size_t binseries(double time[], double flux[], double weight[], size_t N,\
+                 double tbin, int useweight)
+{
+    size_t Nbin = 0;
+    size_t bin, current;
+    double w, sumw, sumt, sumf;
+    double tstart = time[0];
+
+    // Go through the series and write each finished bin
+    size_t i = 0;
+    while ( i < N ) {
+        current = (size_t) ((time[i] - tstart) / tbin);
+        sumw = 0;
+        sumt = 0;
+        sumf = 0;
+        do {
+            w = (useweight != 0) ? weight[i] : 1.0;
+            sumw += w;
+            sumt += w * time[i];
+            sumf += w * flux[i];
+            i++;
+            if ( i == N ) break;
+            bin = (size_t) ((time[i] - tstart) / tbin);
+        } while ( bin == current );
+
+        // Store the bin (never ahead of the points being read)
+        if ( sumw > 0 ) {
+            time[Nbin] = sumt / sumw;
+            flux[Nbin] = sumf / sumw;
+            weight[Nbin] = sumw;
+            Nbin++;
+        }
+    }
+
+    return Nbin;
+}
+
+
+/* Amplitude attenuation of a sinusoid with frequency f (microHz) due to
+ * averaging over bins of length tbin (seconds)
+ */
+double binattenuation(double f, double tbin)
+{
+    double x = PI * f * 1e-6 * tbin;
+    if ( x == 0 ) return 1.0;
+    return fabs(sin(x) / x);
+}
+
+
+/* Binning stage for the programs
+ *  --> Returns the new length of the time series
+ *
+ * The length of the bins is set such that the Nyquist frequency of the binned
+ * series is `margin` times the highest frequency of interest. Does nothing if
+ * that is not longer than the cadence. Without weights, the binned series
+ * will use the number of points per bin as weights, if this is not constant.
+ *
+ * Arguments:
+ *  - `time`     : Array of times (ascending). In seconds!
+ *  - `flux`     : Array of data.
+ *  - `weight`   : Array of statistical weights. OUTPUT -- Weights of the bins.
+ *  - `N`        : Length of the time series
+ *  - `high`     : Highest frequency of interest (in microHz)
+ *  - `margin`   : Safety margin (> 1) of the Nyquist frequency of the bins
+ *  - `useweight`: Flag for use of weights. OUTPUT -- If weights are needed.
+ *  - `quiet`    : Flag. 0 = verbose output. 1 = no output to console
+ */
+size_t binning(double time[], double flux[], double weight[], size_t N,\
+               double high, double margin, int *useweight, int quiet)
+{
+    // Length of the bins and the cadence
+    double tbin = 1.0e6 / (2.0 * margin * high);
+    double* dt = malloc((N-1) * sizeof(double));
+    arr_diff(time, dt, N);
+    double cadence = arr_median(dt, N-1);
+    free(dt);
+
+    if ( quiet == 0 ) printf(" - Binning the time series\n");
+    if ( tbin <= cadence ) {
+        if ( quiet == 0 ) {
+            printf(" -- NB: Bins of %.1lf s not longer than the cadence of"\
+                   " %.1lf s. No binning!\n", tbin, cadence);
+        }
+        return N;
+    }
+
+    // Bin the data
+    size_t Nbin = binseries(time, flux, weight, N, tbin, *useweight);
+
+    // Check if the bins have equal weight (only if not using weights)
+    if ( *useweight == 0 ) {
+        for (size_t i = 1; i < Nbin; ++i) {
+            if ( weight[i] != weight[0] ) {
+                *useweight = 1;
+                break;
+            }
+        }
+    }
+
+    // Display info
+    if ( quiet == 0 ) {
+        printf(" -- INFO: Length of bins = %.1lf s (cadence = %.1lf s)\n",\
+               tbin, cadence);
+        printf(" -- INFO: Length of binned time series = %li (from %li)\n",\
+               Nbin, N);
+        printf(" -- INFO: Amplitude attenuation at %.2lf microHz = %.4lf\n",\
+               high, binattenuation(high, tbin));
+        if ( *useweight != 0 )
+            printf(" -- INFO: Using weights of the bins\n");
+    }
+
+    return Nbin;
+}
@@ -0,0 +1,7 @@
+size_t binseries(double time[], double flux[], double weight[], size_t N,\
+                 double tbin, int useweight);
+
+double binattenuation(double f, double tbin);
+
+size_t binning(double time[], double flux[], double weight[], size_t N,\
+               double high, double margin, int *useweight, int quiet);
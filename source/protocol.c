@@ -0,0 +1,100 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Messages between the analysis server (tsad.c) and its client (tsac.c)
+ *
+ * A client connects to the Unix domain socket, writes one request and reads
+ * one reply. The messages are fixed-size structs (see protocol.h) in the
+ * native byte order -- both ends are on the same machine.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "protocol.h"
+
+
+/* Path of the socket: given, or from TSA_SOCKET, or the default */
+void proto_path(char path[], size_t len, char *given)
+{
+    char* env = getenv("TSA_SOCKET");
+    if ( given != NULL && given[0] != '\0' )
+        snprintf(path, len, "%s", given);
+    else if ( env != NULL && env[0] != '\0' )
+        snprintf(path, len, "%s", env);
+    else
+        snprintf(path, len, "%s", PROTO_SOCKET);
+}
+
+
+/* Create the socket and listen -- returns the descriptor (-1 on failure) */
+int proto_listen(char path[])
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if ( strlen(path) >= sizeof(addr.sun_path) ) return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( fd < 0 ) return -1;
+
+    // Replace a socket left by an earlier server
+    unlink(path);
+    if ( bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||\
+         listen(fd, 64) != 0 ) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/* Connect to the server -- returns the descriptor (-1 on failure) */
+int proto_connect(char path[])
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if ( strlen(path) >= sizeof(addr.sun_path) ) return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( fd < 0 ) return -1;
+    if ( connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/* Write all of buf -- returns 0 on success */
+int proto_write(int fd, void *buf, size_t len)
+{
+    char* p = buf;
+    while ( len > 0 ) {
+        ssize_t n = write(fd, p, len);
+        if ( n <= 0 ) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+
+/* Read all of buf -- returns 0 on success */
+int proto_read(int fd, void *buf, size_t len)
+{
+    char* p = buf;
+    while ( len > 0 ) {
+        ssize_t n = read(fd, p, len);
+        if ( n <= 0 ) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
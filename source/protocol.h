@@ -0,0 +1,50 @@
+#include <stdint.h>
+
+// Magic number of all messages ("TSA1")
+#define PROTO_MAGIC 0x31415354
+
+// Default path of the socket (if TSA_SOCKET is not set)
+#define PROTO_SOCKET "/tmp/tsad.sock"
+
+// Operations
+#define OP_LOAD 1      // Load file `path` as `name` (n = unit, useweight)
+#define OP_UNLOAD 2    // Remove data set `name`
+#define OP_LIST 3      // List the data sets (text)
+#define OP_SPECTRUM 4  // f = {low, high, rate} -> freq, power
+#define OP_WINDOW 5    // f = {f0, limit, rate} -> freq - f0, window
+#define OP_CLEAN 6     // f = {low, high, rate}, n -> freq, power, alpha, beta
+#define OP_FILTER 7    // f = {f1, f2, low, high, rate} -> time, data(, weight)
+#define OP_STOP 8      // Stop the server
+
+// Request (fixed size)
+struct request {
+    uint32_t magic;
+    uint32_t op;
+    int32_t n;
+    int32_t useweight;
+    double f[6];
+    char name[64];
+    char path[256];
+};
+
+// Reply -- followed by `size` bytes: ncol*nrow doubles (column after column)
+// or text (ncol = 0)
+struct reply {
+    uint32_t magic;
+    int32_t status;  // 0 = success, otherwise msg is the error
+    uint32_t ncol;
+    uint32_t pad;
+    uint64_t nrow;
+    uint64_t size;
+    char msg[256];
+};
+
+void proto_path(char path[], size_t len, char *given);
+
+int proto_listen(char path[]);
+
+int proto_connect(char path[]);
+
+int proto_write(int fd, void *buf, size_t len);
+
+int proto_read(int fd, void *buf, size_t len);
@@ -0,0 +1,216 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Multi-resolution pyramid of a spectrum in a binary indexed file
+ *
+ * Level 0 is the full spectrum; each higher level pools `k` records of the
+ * level below, keeping the maximum (and its frequency) and the mean, so the
+ * peaks survive at every zoom level. The levels continue until a single
+ * record is left. The spectrum is pushed in order of frequency (e.g. as the
+ * parts of the calculation finish) and every level is built on the fly;
+ * only a small buffer per level is kept in memory.
+ *
+ * File format (native byte order, all fields 8 bytes):
+ *   - "TSAPYR01", number of levels L, factor k
+ *   - Index, for each level: number of records, offset of the first record
+ *     (bytes from the start of the file), size of a record (bytes) and
+ *     number of frequencies per record (k^level)
+ *   - Level 0 records: frequency, power (doubles)
+ *   - Level l > 0 records: lowest frequency, frequency of the max., max.
+ *     power and mean power (doubles)
+ * A range of any level is one read at offset + i * size. Record i of level l
+ * holds the frequencies i*k^l to (i+1)*k^l - 1 (on an equidistant grid the
+ * index follows from the frequency; otherwise the lowest frequencies of a
+ * level are sorted).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Identifier of the file format
+#define MAGIC "TSAPYR01"
+
+// Max. number of levels and records buffered per level
+#define PYRMAXLEV 64
+#define PYRBUF 4096
+
+// A level of the pyramid (records written and the pool being filled)
+struct pyrlevel {
+    uint64_t n;        // Number of records
+    uint64_t offset;   // Offset of the first record (bytes)
+    uint64_t width;    // Number of doubles per record
+    uint64_t written;  // Records written to the file
+    double* buf;       // Buffered records
+    size_t nbuf;       // Number of buffered records
+    size_t cnt;        // Records of the level below in the pool
+    double flo, fpeak, max, sum, samples;
+};
+
+struct pyramid {
+    FILE* file;
+    int k;
+    int L;
+    struct pyrlevel lev[PYRMAXLEV];
+};
+
+void pyrrecord(struct pyramid *p, int l, double rec[]);
+
+void pyrpool(struct pyramid *p, int l, double flo, double fpeak, double max,\
+             double sum, double samples);
+
+void pyrflush(struct pyramid *p, int l);
+
+
+/* Open the file of a pyramid of a spectrum of M frequencies (factor k)
+ *  --> Writes the header and the index. Returns NULL (with a warning) if
+ *      the file cannot be written
+ */
+struct pyramid* pyr_open(char *fname, size_t M, int k)
+{
+    if ( M == 0 || k < 2 ) return NULL;
+    FILE* outfile = fopen(fname, "wb");
+    if ( outfile == NULL ) {
+        fprintf(stderr, "Warning: Cannot write pyramid \"%s\"\n", fname);
+        return NULL;
+    }
+    struct pyramid* p = calloc(1, sizeof(struct pyramid));
+    p->file = outfile;
+    p->k = k;
+
+    // Number of records per level (until a single record is left)
+    uint64_t n = M;
+    p->L = 0;
+    while ( p->L < PYRMAXLEV ) {
+        p->lev[p->L].n = n;
+        p->lev[p->L].width = ( p->L == 0 ) ? 2 : 4;
+        p->L++;
+        if ( n == 1 ) break;
+        n = (n + k - 1) / k;
+    }
+
+    // Offsets after the header and the index
+    uint64_t offset = 8 + 2 * 8 + p->L * 4 * 8;
+    for (int l = 0; l < p->L; ++l) {
+        p->lev[l].offset = offset;
+        offset += p->lev[l].n * p->lev[l].width * sizeof(double);
+        p->lev[l].buf = malloc(PYRBUF * p->lev[l].width * sizeof(double));
+    }
+
+    // Header and index
+    uint64_t head[2] = {p->L, k};
+    uint64_t samples = 1;
+    fwrite(MAGIC, 1, 8, outfile);
+    fwrite(head, sizeof(uint64_t), 2, outfile);
+    for (int l = 0; l < p->L; ++l) {
+        uint64_t index[4] = {p->lev[l].n, p->lev[l].offset,\
+                             p->lev[l].width * sizeof(double), samples};
+        fwrite(index, sizeof(uint64_t), 4, outfile);
+        samples *= k;
+    }
+
+    return p;
+}
+
+
+/* Add the next n frequencies (in order) of the spectrum to the pyramid */
+void pyr_push(struct pyramid *p, double freq[], double power[], size_t n)
+{
+    if ( p == NULL ) return;
+    double rec[2];
+    for (size_t j = 0; j < n; ++j) {
+        rec[0] = freq[j];
+        rec[1] = power[j];
+        pyrrecord(p, 0, rec);
+        if ( p->L > 1 )
+            pyrpool(p, 1, freq[j], freq[j], power[j], power[j], 1);
+    }
+}
+
+
+/* Write the last (partial) pools, check the levels and close the file
+ *  --> Returns 0 on success
+ */
+int pyr_close(struct pyramid *p)
+{
+    if ( p == NULL ) return 1;
+
+    // Partial pools (from the bottom, as they feed the levels above)
+    for (int l = 1; l < p->L; ++l) {
+        struct pyrlevel* v = &p->lev[l];
+        if ( v->cnt > 0 ) {
+            double rec[4] = {v->flo, v->fpeak, v->max, v->sum / v->samples};
+            pyrrecord(p, l, rec);
+            if ( l + 1 < p->L )
+                pyrpool(p, l + 1, v->flo, v->fpeak, v->max, v->sum,\
+                        v->samples);
+            v->cnt = 0;
+        }
+    }
+
+    // Remaining buffers
+    int fail = 0;
+    for (int l = 0; l < p->L; ++l) {
+        pyrflush(p, l);
+        if ( p->lev[l].written != p->lev[l].n ) fail = 1;
+        free(p->lev[l].buf);
+    }
+    if ( fclose(p->file) != 0 ) fail = 1;
+    if ( fail != 0 ) fprintf(stderr, "Warning: Incomplete pyramid!\n");
+    free(p);
+
+    return fail;
+}
+
+
+// Buffer a record of level l (written when the buffer is full)
+void pyrrecord(struct pyramid *p, int l, double rec[])
+{
+    struct pyrlevel* v = &p->lev[l];
+    memcpy(&v->buf[v->nbuf * v->width], rec, v->width * sizeof(double));
+    v->nbuf++;
+    if ( v->nbuf == PYRBUF ) pyrflush(p, l);
+}
+
+
+// Add a record of the level below to the pool of level l
+void pyrpool(struct pyramid *p, int l, double flo, double fpeak, double max,\
+             double sum, double samples)
+{
+    struct pyrlevel* v = &p->lev[l];
+    if ( v->cnt == 0 || max > v->max ) {
+        v->max = max;
+        v->fpeak = fpeak;
+    }
+    if ( v->cnt == 0 ) {
+        v->flo = flo;
+        v->sum = 0;
+        v->samples = 0;
+    }
+    v->sum += sum;
+    v->samples += samples;
+    v->cnt++;
+
+    // Pool complete: Record of this level, pooled into the next
+    if ( v->cnt == (size_t) p->k ) {
+        double rec[4] = {v->flo, v->fpeak, v->max, v->sum / v->samples};
+        pyrrecord(p, l, rec);
+        if ( l + 1 < p->L )
+            pyrpool(p, l + 1, v->flo, v->fpeak, v->max, v->sum, v->samples);
+        v->cnt = 0;
+    }
+}
+
+
+// Write the buffered records of level l at their place in the file
+void pyrflush(struct pyramid *p, int l)
+{
+    struct pyrlevel* v = &p->lev[l];
+    if ( v->nbuf == 0 ) return;
+    size_t bytes = v->width * sizeof(double);
+    if ( v->written + v->nbuf <= v->n &&\
+         fseeko(p->file, v->offset + v->written * bytes, SEEK_SET) == 0 &&\
+         fwrite(v->buf, bytes, v->nbuf, p->file) == v->nbuf )
+        v->written += v->nbuf;
+    v->nbuf = 0;
+}
@@ -0,0 +1,7 @@
+struct pyramid;
+
+struct pyramid* pyr_open(char *fname, size_t M, int k);
+
+void pyr_push(struct pyramid *p, double freq[], double power[], size_t n);
+
+int pyr_close(struct pyramid *p);
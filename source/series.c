@@ -0,0 +1,345 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Prepared time series shared by the kernels
+ *
+ * The quantities every kernel needs (sum of the weights, weight * data) are
+ * calculated once when the series is prepared, instead of in every call of
+ * fourier(), fouriermax(), windowfunction() and bandpass() -- e.g. in each
+ * iteration of CLEAN, or for each band of a filter. The arrays are 64-byte
+ * aligned and padded to a multiple of SERIESPAD elements. The padding
+ * repeats the last time with zero data and zero weight, so the weighted sums
+ * may run over the padded length (Npad) unchanged.
+ *
+ * Quantities needed by some kernels only are determined on first use and
+ * kept with the series: the times centred around the middle (series_ctime,
+ * single-precision engine), the cadence grid (series_grid, FFT engine and
+ * window) and the hash of the sampling (series_key, window cache).
+ *
+ * A series can also wrap arrays of the caller (series_wrap, no copies and
+ * no alignment guarantee), which the array interfaces of the kernels use.
+ *
+ * With the threads pinned (-numa, see numa.c), a prepared series can be
+ * replicated on every NUMA node (series_replicate), so the threads of the
+ * parallel loops read the data from the memory of their own node
+ * (series_local) instead of all from the node of the thread which read it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <omp.h>
+
+#include "arrlib.h"
+#include "numa.h"
+#include "wincache.h"
+#include "series.h"
+
+// Alignment (bytes) and padding (elements) of the arrays
+#define SERIESALIGN 64
+#define SERIESPAD 8
+
+// Max. distance of the times from the cadence grid (fraction of the cadence;
+// only times exactly on the grid, so the FFT engine and window equal the
+// direct sums)
+#define SERIESGRIDTOL 1.0e-9
+
+double* alignedarray(size_t Npad);
+
+void seriesinit(struct series *s, double time[], size_t N, int useweight);
+
+struct series* seriescopy(struct series *s);
+
+
+/* Prepare a series (aligned copies of the arrays)
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `flux`     : Array of data.
+ *  - `weight`   : Array of statistical weights (only used if useweight != 0).
+ *  - `N`        : Length of the time series
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ *
+ * Without weights, all weights are 1 (and weight * data is the data).
+ */
+struct series* series_prepare(double time[], double flux[], double weight[],\
+                              size_t N, int useweight)
+{
+    struct series* s = malloc(sizeof(struct series));
+    size_t Npad = (N + SERIESPAD - 1) / SERIESPAD * SERIESPAD;
+
+    seriesinit(s, time, N, useweight);
+    s->Npad = Npad;
+    s->owned = 1;
+    s->time = alignedarray(Npad);
+    s->flux = alignedarray(Npad);
+    s->weight = alignedarray(Npad);
+    s->wflux = alignedarray(Npad);
+
+    // Copy and pad (the data and weights of the padding stay zero)
+    memcpy(s->time, time, N * sizeof(double));
+    memcpy(s->flux, flux, N * sizeof(double));
+    for (size_t i = 0; i < N; ++i) {
+        s->weight[i] = ( useweight != 0 ) ? weight[i] : 1.0;
+    }
+    for (size_t i = N; i < Npad; ++i) {
+        s->time[i] = time[N-1];
+    }
+
+    // Sum of the weights and weight * data
+    s->wsum = ( useweight != 0 ) ? arr_sum(weight, N) : N;
+    series_update(s);
+
+    return s;
+}
+
+
+/* Wrap the arrays of the caller as a series (no copies)
+ *  --> Only weight * data is allocated (with weights); free with
+ *      series_free. `flux` may be NULL for the window function (times and
+ *      weights only)
+ */
+void series_wrap(struct series *s, double time[], double flux[],\
+                 double weight[], size_t N, int useweight)
+{
+    seriesinit(s, time, N, useweight);
+    s->Npad = N;
+    s->owned = 0;
+    s->time = time;
+    s->flux = flux;
+    s->weight = weight;
+    s->wsum = ( useweight != 0 ) ? arr_sum(weight, N) : N;
+
+    // Without weights, the weighted data is the data
+    if ( useweight != 0 && flux != NULL ) {
+        s->wflux = malloc(N * sizeof(double));
+        series_update(s);
+    }
+    else {
+        s->wflux = flux;
+    }
+}
+
+
+/* Replicate a prepared series on every NUMA node used by the threads
+ *  --> Each copy is allocated and filled by the first thread on its node (so
+ *      its pages are placed there); the series itself serves node 0. Does
+ *      nothing for a wrapped series or without numa_pin (one node)
+ */
+void series_replicate(struct series *s)
+{
+    int nodes = numa_nodes();
+    if ( s->owned == 0 || s->nnode > 0 || nodes <= 1 ) return;
+
+    s->node = malloc(nodes * sizeof(struct series*));
+    s->nnode = nodes;
+    s->node[0] = s;
+    for (int k = 1; k < nodes; ++k) {
+        s->node[k] = NULL;
+    }
+
+    // The first thread to claim a node makes its copy (nodes without a
+    // thread in this team keep the series itself)
+    #pragma omp parallel default(shared)
+    {
+        int k = numa_node();
+        int mine = 0;
+        if ( k > 0 ) {
+            #pragma omp critical
+            {
+                if ( s->node[k] == NULL ) {
+                    s->node[k] = s;
+                    mine = 1;
+                }
+            }
+        }
+        if ( mine ) s->node[k] = seriescopy(s);
+    }
+}
+
+
+/* The copy of a series on the node of the calling thread (or the series) */
+struct series* series_local(struct series *s)
+{
+    if ( s->nnode > 1 ) return s->node[numa_node()];
+    return s;
+}
+
+
+/* Times centred around the middle of the series (single-precision engine)
+ *  --> Calculated on first use (padded as the times); the middle is s->tmid
+ */
+double* series_ctime(struct series *s)
+{
+    if ( s->tcen == NULL ) {
+        s->tcen = malloc(s->Npad * sizeof(double));
+        for (size_t i = 0; i < s->Npad; ++i) {
+            s->tcen[i] = s->time[i] - s->tmid;
+        }
+    }
+    return s->tcen;
+}
+
+
+/* Cadence grid of the times (see arr_util_cadence)
+ *  --> Returns the length of the grid from t0 in steps of dt, or 0 if the
+ *      times are not on a grid. Determined on first use
+ */
+size_t series_grid(struct series *s, double *t0, double *dt)
+{
+    if ( s->gridknown == 0 ) {
+        s->grid = arr_util_cadence(s->time, s->N, SERIESGRIDTOL, &s->t0,\
+                                   &s->dt);
+        s->gridknown = 1;
+    }
+    *t0 = s->t0;
+    *dt = s->dt;
+    return s->grid;
+}
+
+
+/* Hash of the times (and weights) for the window cache (see wincache.c)
+ *  --> Determined on first use (the sampling of a series never changes)
+ */
+uint64_t series_key(struct series *s)
+{
+    if ( s->keyknown == 0 ) {
+        s->key = wincache_datakey(s->time, s->weight, s->N, s->useweight);
+        s->keyknown = 1;
+    }
+    return s->key;
+}
+
+
+/* Subtract the mean from the data (e.g. before a filter)
+ *  --> The total subtracted is kept in s->mean (to be added again)
+ */
+void series_submean(struct series *s)
+{
+    double fmean = arr_mean(s->flux, s->N);
+    arr_sca_add(s->flux, -fmean, s->N);
+    s->mean += fmean;
+    series_update(s);
+
+    // Copies on the other nodes
+    for (int k = 1; k < s->nnode; ++k) {
+        if ( s->node[k] == s ) continue;
+        memcpy(s->node[k]->flux, s->flux, s->N * sizeof(double));
+        memcpy(s->node[k]->wflux, s->wflux, s->N * sizeof(double));
+        s->node[k]->mean = s->mean;
+    }
+}
+
+
+/* Update weight * data after the data has changed (e.g. in CLEAN) */
+void series_update(struct series *s)
+{
+    if ( s->wflux == s->flux ) return;
+    for (size_t i = 0; i < s->N; ++i) {
+        s->wflux[i] = s->weight[i] * s->flux[i];
+    }
+}
+
+
+/* Subtract a sinusoid from the data (e.g. a peak found by CLEAN)
+ *  --> `ny` is the angular frequency, `alpha` and `beta` the coefficients of
+ *      sin and cos. Weight * data is updated in the same (parallel) pass
+ */
+void series_subtract(struct series *s, double ny, double alpha, double beta)
+{
+    int weighted = ( s->wflux != s->flux );
+
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0; i < s->N; ++i) {
+        double phi = ny * s->time[i];
+        s->flux[i] = s->flux[i] - alpha * sin(phi) - beta * cos(phi);
+        if ( weighted ) s->wflux[i] = s->weight[i] * s->flux[i];
+    }
+
+    // Copies on the other nodes (their pages stay on their nodes)
+    for (int k = 1; k < s->nnode; ++k) {
+        if ( s->node[k] == s ) continue;
+        memcpy(s->node[k]->flux, s->flux, s->N * sizeof(double));
+        if ( weighted )
+            memcpy(s->node[k]->wflux, s->wflux, s->N * sizeof(double));
+    }
+}
+
+
+/* Free a series (prepared) or its allocations (wrapped) */
+void series_free(struct series *s)
+{
+    if ( s->owned != 0 ) {
+        for (int k = 1; k < s->nnode; ++k) {
+            if ( s->node[k] != s ) series_free(s->node[k]);
+        }
+        free(s->node);
+        free(s->tcen);
+        free(s->time);
+        free(s->flux);
+        free(s->weight);
+        free(s->wflux);
+        free(s);
+    }
+    else {
+        if ( s->wflux != s->flux ) free(s->wflux);
+        free(s->tcen);
+    }
+}
+
+
+// Copy of a prepared series (allocated and touched by the calling thread)
+struct series* seriescopy(struct series *s)
+{
+    struct series* c = malloc(sizeof(struct series));
+    *c = *s;
+    c->node = NULL;
+    c->nnode = 0;
+    c->tcen = NULL;
+    c->time = alignedarray(s->Npad);
+    c->flux = alignedarray(s->Npad);
+    c->weight = alignedarray(s->Npad);
+    c->wflux = alignedarray(s->Npad);
+    memcpy(c->time, s->time, s->Npad * sizeof(double));
+    memcpy(c->flux, s->flux, s->Npad * sizeof(double));
+    memcpy(c->weight, s->weight, s->Npad * sizeof(double));
+    memcpy(c->wflux, s->wflux, s->Npad * sizeof(double));
+    return c;
+}
+
+
+// Fields common to prepared and wrapped series (nothing determined yet)
+void seriesinit(struct series *s, double time[], size_t N, int useweight)
+{
+    s->N = N;
+    s->useweight = useweight;
+    s->tcen = NULL;
+    s->tmid = ( N > 0 ) ? 0.5 * (time[0] + time[N-1]) : 0;
+    s->mean = 0;
+    s->gridknown = 0;
+    s->grid = 0;
+    s->t0 = 0;
+    s->dt = 0;
+    s->keyknown = 0;
+    s->key = 0;
+    s->node = NULL;
+    s->nnode = 0;
+}
+
+
+// Aligned (and zeroed) array of Npad doubles
+double* alignedarray(size_t Npad)
+{
+    size_t bytes = Npad * sizeof(double);
+    bytes = (bytes + SERIESALIGN - 1) / SERIESALIGN * SERIESALIGN;
+    if ( bytes == 0 ) bytes = SERIESALIGN;
+
+    void* x = NULL;
+    if ( posix_memalign(&x, SERIESALIGN, bytes) != 0 ) {
+        fprintf(stderr, "ERROR: Cannot allocate the series !\n");
+        exit(1);
+    }
+    memset(x, 0, bytes);
+    return x;
+}
@@ -0,0 +1,47 @@
+// Prepared time series (see series.c)
+struct series {
+    double* time;      // Times (seconds)
+    double* flux;      // Data
+    double* weight;    // Statistical weights (1 without weights)
+    double* wflux;     // weight * data
+    double* tcen;      // Times from the middle (NULL until series_ctime)
+    size_t N;          // Length of the series
+    size_t Npad;       // Length of the arrays (padded with zero weight)
+    int useweight;     // Weights used (0 = no weights)
+    int owned;         // Arrays allocated by series_prepare
+    double wsum;       // Sum of the weights
+    double tmid;       // Middle of the time span (origin of tcen)
+    double mean;       // Mean subtracted from the data (see series_submean)
+    int gridknown;     // Cadence grid determined (see series_grid)
+    size_t grid;       // Length of the cadence grid (0 = not on a grid)
+    double t0;         // First point of the cadence grid
+    double dt;         // Cadence
+    int keyknown;      // Hash of the sampling determined (see series_key)
+    uint64_t key;      // Hash of the times and weights
+    struct series** node;  // Copies per NUMA node (see series_replicate)
+    int nnode;         // Number of copies (0 = none)
+};
+
+struct series* series_prepare(double time[], double flux[], double weight[],\
+                              size_t N, int useweight);
+
+void series_wrap(struct series *s, double time[], double flux[],\
+                 double weight[], size_t N, int useweight);
+
+void series_replicate(struct series *s);
+
+struct series* series_local(struct series *s);
+
+double* series_ctime(struct series *s);
+
+size_t series_grid(struct series *s, double *t0, double *dt);
+
+uint64_t series_key(struct series *s);
+
+void series_submean(struct series *s);
+
+void series_update(struct series *s);
+
+void series_subtract(struct series *s, double ny, double alpha, double beta);
+
+void series_free(struct series *s);
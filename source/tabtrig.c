@@ -0,0 +1,159 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Table-driven sines and cosines with integer phase accumulation
+ *
+ * For equidistant frequencies the phase of a data point increases by the same
+ * amount from one frequency to the next. The phase is kept as a 64-bit
+ * fixed-point fraction of a turn, so the increments are exact and never
+ * drift. Sine and cosine come from a small table (fits in the L1 cache) with
+ * a polynomial correction for the distance to the nearest table entry.
+ *
+ * Accuracy tiers:
+ *  - 1: Max. error 1e-10 (1024 entries, 3rd order correction)
+ *  - 2: Max. error 1e-6  (256 entries, 2nd order correction)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <omp.h>
+
+#define PI2 6.28318530717958647692528676655900576839433879875
+
+// Largest table (bits of the index) and frequencies per block of the sums
+#define TABBITSMAX 10
+#define TABBLOCK 512
+
+// Table of sin and cos (interleaved) and the bits of the index in use
+static double table[2 << TABBITSMAX];
+static int tabbits = 0;
+static int tabtier = 0;
+
+
+/* Build the table for an accuracy tier (see above) */
+void tabtrig_init(int tier)
+{
+    tabtier = tier;
+    tabbits = (tier == 1) ? 10 : 8;
+    size_t size = (size_t) 1 << tabbits;
+    for (size_t k = 0; k < size; ++k) {
+        table[2*k] = sin(PI2 * k / size);
+        table[2*k+1] = cos(PI2 * k / size);
+    }
+}
+
+
+// Sine and cosine of a phase (fraction of a turn in 64-bit fixed point)
+static inline void tabsincos(uint64_t phase, double *sn, double *cn)
+{
+    // Nearest entry and the (signed) remainder in radians
+    int shift = 64 - tabbits;
+    uint64_t idx = (phase + ((uint64_t) 1 << (shift - 1))) >> shift;
+    int64_t rem = (int64_t) (phase - (idx << shift));
+    double d = rem * (PI2 / 18446744073709551616.0);
+    idx &= ((uint64_t) 1 << tabbits) - 1;
+
+    // sin(a + d) and cos(a + d) with polynomials for sin(d) and cos(d)
+    double d2 = d * d;
+    double sd, cd;
+    if ( tabtier == 1 ) {
+        sd = d * (1.0 - d2 * (1.0/6.0));
+        cd = 1.0 - 0.5 * d2;
+    }
+    else {
+        sd = d;
+        cd = 1.0 - 0.5 * d2;
+    }
+    double sa = table[2*idx];
+    double ca = table[2*idx+1];
+    *sn = sa * cd + ca * sd;
+    *cn = ca * cd - sa * sd;
+}
+
+
+// Fractional part of x (in turns) as 64-bit fixed point
+static inline uint64_t fixedphase(long double x)
+{
+    long double frac = x - floorl(x);
+    return (uint64_t) ldexpl(frac, 64);
+}
+
+
+/* Measure the max. error of the table compared to the C library
+ *  --> Evaluated at a large number of pseudo-random phases
+ */
+double tabtrig_maxerror(void)
+{
+    double sn, cn, a, err;
+    double maxerr = 0;
+    uint64_t phase = 0x9E3779B97F4A7C15ULL;
+
+    for (size_t i = 0; i < 1000000; ++i) {
+        // Step through the phases using a (xorshift) random sequence
+        phase ^= phase << 13;
+        phase ^= phase >> 7;
+        phase ^= phase << 17;
+
+        tabsincos(phase, &sn, &cn);
+        a = ldexp((double) phase, -64) * PI2;
+        err = fmax(fabs(sn - sin(a)), fabs(cn - cos(a)));
+        if ( err > maxerr ) maxerr = err;
+    }
+    return maxerr;
+}
+
+
+/* Calculate the least-squares sums for equidistant frequencies
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `flux`     : Array of data.
+ *  - `weight`   : Array of statistical weights.
+ *  - `N`        : Length of the time series
+ *  - `f0`       : First cyclic frequency (in microHz)
+ *  - `df`       : Spacing of the cyclic frequencies (in microHz)
+ *  - `M`        : Number of frequencies
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ *  - `s`, `c`   : OUTPUT -- Sums of (weighted) data times sin and cos
+ *  - `cc`, `sc` : OUTPUT -- Sums of (weighted) cos^2 and sin*cos
+ */
+void tabtrig_sums(double time[], double flux[], double weight[], size_t N,\
+                  double f0, double df, size_t M, int useweight, double s[],\
+                  double c[], double cc[], double sc[])
+{
+    size_t Nblock = (M + TABBLOCK - 1) / TABBLOCK;
+
+    // Each block of frequencies runs through all of the data
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t blk = 0; blk < Nblock; ++blk) {
+        size_t j0 = blk * TABBLOCK;
+        size_t Mblk = (M - j0 < TABBLOCK) ? M - j0 : TABBLOCK;
+        double sn, cn, wf, w;
+        uint64_t phase, inc;
+
+        for (size_t j = j0; j < j0 + Mblk; ++j) {
+            s[j] = 0;
+            c[j] = 0;
+            cc[j] = 0;
+            sc[j] = 0;
+        }
+
+        for (size_t i = 0; i < N; ++i) {
+            // Phase at the first frequency and the increment (in turns)
+            phase = fixedphase((long double) (f0 + j0*df) * 1e-6L * time[i]);
+            inc = fixedphase((long double) df * 1e-6L * time[i]);
+            w = (useweight != 0) ? weight[i] : 1.0;
+            wf = w * flux[i];
+
+            for (size_t j = j0; j < j0 + Mblk; ++j) {
+                tabsincos(phase, &sn, &cn);
+                s[j] += wf * sn;
+                c[j] += wf * cn;
+                cc[j] += w * cn * cn;
+                sc[j] += w * sn * cn;
+                phase += inc;
+            }
+        }
+    }
+}
@@ -0,0 +1,7 @@
+void tabtrig_init(int tier);
+
+double tabtrig_maxerror(void);
+
+void tabtrig_sums(double time[], double flux[], double weight[], size_t N,\
+                  double f0, double df, size_t M, int useweight, double s[],\
+                  double c[], double cc[], double sc[]);
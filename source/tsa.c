@@ -0,0 +1,255 @@
+/*  ~~~ Time Series Analysis -- Pipeline ~~~
+ *
+ * Usage:
+ * tsa.x [options] sampling inputfile stage [stage ...]
+ * tsa.x [options] sampling -p pipelinefile inputfile
+ *
+ * Runs several stages (CLEAN, filters, power spectra) in one process. The
+ * time series is read once and kept in memory between the stages; only the
+ * outputs requested by the stages are written. Products are shared between
+ * the stages: The Nyquist frequency is found once, the sum of the window
+ * (for the filters) is calculated once, and a stage on the same frequency
+ * grid as the last calculated spectrum of unchanged data reuses it.
+ *
+ * Sampling: -f {auto | low high rate}
+ *   auto: Use the range from 5 microHertz to the Nyquist frequency with four
+ *         times oversampling (auto is a key word, use as "-f auto").
+ *   low high rate: Values for sampling in microHz (e.g. "-f 1500 4000 0.1", to
+ *                  sample from 1500 to 4000 microHz in steps of 0.1 microHz).
+ *   The range is used by CLEAN and for the window of the filters; the rate
+ *   is used by all of the stages.
+ *
+ * Stages (run in the given order):
+ *   clean n file          : CLEAN n frequencies. The log is written to file
+ *                           (as the .cleanlog of fclean.x; "-" for no log).
+ *   band f1 f2            : Bandpass filter between f1 and f2 (in microHz).
+ *   lowpass f             : Lowpass filter with f (in microHz) as limit.
+ *   highpass f            : Highpass filter with f (in microHz) as limit.
+ *   spectrum low high file: Power spectrum of the current data from low to
+ *                           high (in microHz), written to file.
+ *   save file             : Write the current time series to file.
+ *
+ * Example (CLEAN 20 peaks, bandpass and spectrum of the result):
+ *   tsa.x -tday -f auto in.txt clean 20 - band 1000 5000 save filt.txt \
+ *         spectrum 5 8000 spec.txt
+ *
+ * Options:
+ *  -p file: Read the stages from file instead of the command line (white
+ *           space separated as above; # starts a comment).
+ *  -w: Use weights -- requires an extra column in the input file containing
+ *      weight per data point.
+ *  -q: Quiet-mode. No output to console.
+ *  -t{sec|day|ms}: Unit of input file (seconds [default], days, megaseconds).
+ *  -engine {auto|direct|fft|zoom|float}: Engine for the power spectra (see
+ *         powerspec.c).
+ *  -trig {exact|1e-10|1e-6}: Accuracy of sin/cos in the direct sums (see
+ *         powerspec.c).
+ *
+ * Note:
+ * Using multi-threading with OpenMP. Set number of threads used by the shell
+ * variable "OMP_NUM_THREADS".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "fileio.h"
+#include "arrlib.h"
+#include "tsfourier.h"
+#include "pipeline.h"
+
+
+int main(int argc, char *argv[])
+{
+    /* Important definitions */
+    // Lengths
+    size_t N = 0;  // Length of time series
+    int S = 0;     // Number of stages
+
+    // Filenames
+    char inname[100] = "";
+    char pipename[100] = "";
+
+    // Sampling
+    double low = 0, high = 0, rate = 0;
+
+    // Options
+    int quiet = 0;
+    int unit = 1;
+    int autosamp = 0;
+    int isamp = 0;
+    int useweight = 0;
+    int engine = 0;
+    int trig = 0;
+
+    // Stages
+    struct stage stages[STAGEMAX];
+
+
+    /* Process command line arguments */
+    if ( argc < 5 ) {
+        fprintf(stderr, "usage: %s  [-w] [-q] [-t{sec|day|ms}]" \
+                " [-engine name] [-trig accuracy]" \
+                " -f {auto | low high rate}" \
+                " {-p pipeline_file input_file | input_file stage ...}\n",\
+                argv[0]);
+        exit(1);
+    }
+
+    // Options (until the input file)
+    int i;
+    for (i = 1; i < argc; ++i) {
+        if ( strcmp(argv[i], "-q" ) == 0 ) {
+            quiet = 1;
+        }
+        else if ( strcmp(argv[i], "-tsec" ) == 0 ) {
+            unit = 1;
+        }
+        else if ( strcmp(argv[i], "-tday" ) == 0 ) {
+            unit = 2;
+        }
+        else if ( strcmp(argv[i], "-tms" ) == 0 ) {
+            unit = 3;
+        }
+        else if ( strcmp(argv[i], "-w" ) == 0 ) {
+            useweight = 1;
+        }
+        else if ( strcmp(argv[i], "-p" ) == 0 && i + 1 < argc ) {
+            i++;
+            strncpy(pipename, argv[i], 99);
+        }
+        else if ( strcmp(argv[i], "-trig" ) == 0 && i + 1 < argc ) {
+            i++;
+            if ( strcmp(argv[i], "exact" ) == 0 ) trig = 0;
+            else if ( strcmp(argv[i], "1e-10" ) == 0 ) trig = 1;
+            else if ( strcmp(argv[i], "1e-6" ) == 0 ) trig = 2;
+            else {
+                fprintf(stderr, "Unknown accuracy \"%s\"! Quitting!\n",\
+                        argv[i]);
+                exit(1);
+            }
+        }
+        else if ( strcmp(argv[i], "-engine" ) == 0 && i + 1 < argc ) {
+            i++;
+            if ( strcmp(argv[i], "auto" ) == 0 ) engine = 0;
+            else if ( strcmp(argv[i], "direct" ) == 0 ) engine = 1;
+            else if ( strcmp(argv[i], "fft" ) == 0 ) engine = 2;
+            else if ( strcmp(argv[i], "zoom" ) == 0 ) engine = 3;
+            else if ( strcmp(argv[i], "float" ) == 0 ) engine = 4;
+            else {
+                fprintf(stderr, "Unknown engine \"%s\"! Quitting!\n",\
+                        argv[i]);
+                exit(1);
+            }
+        }
+        else if ( strcmp(argv[i], "-f" ) == 0 && i + 1 < argc ) {
+            i++;
+            if ( strcmp(argv[i], "auto") == 0) {
+                isamp = 1;
+                autosamp = 1;
+            }
+            else if ( i + 2 < argc ) {
+                isamp = 2;
+                low = atof(argv[i]);
+                high = atof(argv[i+1]);
+                rate = atof(argv[i+2]);
+                i += 2;
+            }
+        }
+        else {
+            // Input file -- the rest are the stages
+            strncpy(inname, argv[i], 99);
+            i++;
+            break;
+        }
+    }
+
+    // Exit if no (or wrong) sampling provided
+    if ( isamp == 0 ) {
+        fprintf(stderr, "No or wrong sampling provided! Quitting!\n");
+        exit(1);
+    }
+
+    // Stages from the file or the command line
+    if ( pipename[0] != '\0' )
+        S = pipeline_file(pipename, stages, STAGEMAX);
+    else
+        S = pipeline_parse(argc - i, &argv[i], stages, STAGEMAX);
+    if ( S <= 0 ) {
+        fprintf(stderr, "No or wrong stages provided! Quitting!\n");
+        exit(1);
+    }
+
+    // Count lines in the input file (quits if it cannot be opened)
+    N = countlines(inname);
+    fourier_setengine(engine);
+    double trigerr = fourier_settrig(trig);
+
+    // Pretty print
+    if ( quiet == 0 )
+        printf("\nRunning %i stages on the time series \"%s\" ...\n", S,\
+               inname);
+
+
+    /* Read data (and weights) from the input file */
+    if ( quiet == 0 ) printf(" - Reading input\n");
+    double* time = malloc(N * sizeof(double));
+    double* flux = malloc(N * sizeof(double));
+    double* weight = malloc(N * sizeof(double));
+    readcols(inname, time, flux, weight, N, useweight, 0, 0, unit, quiet);
+
+    // Calculate Nyquist frequency (once for all stages)
+    double* dt = malloc((N-1) * sizeof(double));
+    double nyquist;
+    arr_diff(time, dt, N);
+    nyquist = 1.0 / (2.0 * arr_median(dt, N-1)) * 1e6; // microHz !
+    free(dt);
+
+    // Calculate suggested sampling (4 times oversampling)
+    double minsamp;
+    minsamp = 1.0e6 / (4 * (time[N-1] - time[0])); // microHz !
+
+    // Display info?
+    if ( quiet == 0 ){
+        printf(" -- INFO: Length of time series = %li\n", N);
+        printf(" -- INFO: Nyquist frequency = %.2lf microHz\n", nyquist);
+        printf(" -- INFO: Suggested minimum sampling = %.3lf microHz\n",\
+               minsamp);
+    }
+
+    // Apply automatic sampling?
+    if ( autosamp != 0 ) {
+        low = 5.0;
+        high = nyquist;
+        rate = minsamp;
+    }
+    if ( quiet == 0 ) {
+        printf(" -- INFO: Sampling (in microHz): %.2lf to %.2lf in steps of"\
+               " %.4lf\n", low, high, rate);
+        if ( trig != 0 )
+            printf(" -- INFO: Table-driven sin/cos with max. error %.2le\n",\
+                   trigerr);
+    }
+
+
+    /* Run the stages */
+    struct pipestate ps;
+    pipeline_init(&ps, inname, time, flux, weight, N, useweight, unit, low,\
+                  high, rate);
+    pipeline_run(&ps, stages, S, quiet);
+    pipeline_free(&ps);
+
+
+    /* Free data */
+    free(time);
+    free(flux);
+    free(weight);
+
+
+    /* Done! */
+    if ( quiet == 0 ) printf("Done!\n\n");
+    return 0;
+}
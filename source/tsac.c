@@ -0,0 +1,201 @@
+/*  ~~~ Time Series Analysis -- Client of the Analysis Server ~~~
+ *
+ * Usage:
+ * tsac.x [-s socket] command [arguments]
+ *
+ * Sends one request to the analysis server (tsad.x) and writes the answer.
+ * Output files can be "-" to write to the console. The frequencies are in
+ * microHz.
+ *
+ * Commands:
+ *   load name file [-w] [-t{sec|day|ms}]: Load the time series in file as
+ *                                         data set `name` (with weights).
+ *   unload name                         : Remove the data set.
+ *   list                                : List the loaded data sets.
+ *   spectrum name low high rate outfile : Power spectrum (as powerspec.x).
+ *   window name f0 limit rate outfile   : Window function at f0 in the
+ *                                         range +/- limit (as powerspec.x).
+ *   clean name n low high rate outfile  : Find n frequencies with CLEAN
+ *                                         (written as the log of fclean.x).
+ *   filter name f1 f2 low high rate outfile: Bandpass filter between f1 and
+ *                                         f2, with the window sum over the
+ *                                         sampling (as filter.x).
+ *   stop                                : Stop the server.
+ *
+ * Options:
+ *  -s socket: Path of the socket (default: $TSA_SOCKET or /tmp/tsad.sock).
+ *
+ * Example:
+ *   tsac.x load star data/star.txt -tday
+ *   tsac.x spectrum star 1000 5000 0.1 spec.txt
+ *   tsac.x filter star 2000 3000 1000 5000 0.1 filt.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "protocol.h"
+
+
+int main(int argc, char *argv[])
+{
+    /* Important definitions */
+    char given[256] = "";
+    char path[256];
+    char outname[256] = "-";
+    struct request req;
+    struct reply rep;
+    int nf = 0;  // Number of frequencies of the command
+
+
+    /* Process command line arguments */
+    int i = 1;
+    if ( i + 1 < argc && strcmp(argv[i], "-s") == 0 ) {
+        strncpy(given, argv[i+1], 255);
+        i += 2;
+    }
+    if ( i >= argc ) {
+        fprintf(stderr, "usage: %s  [-s socket] {load name file [-w]"\
+                " [-t{sec|day|ms}] | unload name | list |"\
+                " spectrum name low high rate outfile |"\
+                " window name f0 limit rate outfile |"\
+                " clean name n low high rate outfile |"\
+                " filter name f1 f2 low high rate outfile | stop}\n",\
+                argv[0]);
+        exit(1);
+    }
+
+    // Build the request
+    memset(&req, 0, sizeof(req));
+    req.magic = PROTO_MAGIC;
+    char* cmd = argv[i++];
+    if ( strcmp(cmd, "load") == 0 && i + 1 < argc ) {
+        req.op = OP_LOAD;
+        req.n = 1;
+        strncpy(req.name, argv[i], sizeof(req.name) - 1);
+
+        // The server reads the file -- give it the full path
+        char full[PATH_MAX];
+        char* given = argv[i+1];
+        if ( realpath(given, full) != NULL ) given = full;
+        if ( strlen(given) >= sizeof(req.path) ) {
+            fprintf(stderr, "Path of the file is too long! Quitting!\n");
+            exit(1);
+        }
+        strcpy(req.path, given);
+        for (i = i + 2; i < argc; ++i) {
+            if ( strcmp(argv[i], "-w") == 0 ) req.useweight = 1;
+            else if ( strcmp(argv[i], "-tsec") == 0 ) req.n = 1;
+            else if ( strcmp(argv[i], "-tday") == 0 ) req.n = 2;
+            else if ( strcmp(argv[i], "-tms") == 0 ) req.n = 3;
+        }
+    }
+    else if ( strcmp(cmd, "unload") == 0 && i < argc ) {
+        req.op = OP_UNLOAD;
+        strncpy(req.name, argv[i], sizeof(req.name) - 1);
+    }
+    else if ( strcmp(cmd, "list") == 0 ) {
+        req.op = OP_LIST;
+    }
+    else if ( strcmp(cmd, "stop") == 0 ) {
+        req.op = OP_STOP;
+    }
+    else {
+        // Commands on a data set: name, [n], frequencies, output file
+        if ( strcmp(cmd, "spectrum") == 0 ) {
+            req.op = OP_SPECTRUM;
+            nf = 3;
+        }
+        else if ( strcmp(cmd, "window") == 0 ) {
+            req.op = OP_WINDOW;
+            nf = 3;
+        }
+        else if ( strcmp(cmd, "clean") == 0 ) {
+            req.op = OP_CLEAN;
+            nf = 3;
+        }
+        else if ( strcmp(cmd, "filter") == 0 ) {
+            req.op = OP_FILTER;
+            nf = 5;
+        }
+        int need = 2 + nf + ( req.op == OP_CLEAN ? 1 : 0 );
+        if ( nf == 0 || i + need > argc ) {
+            fprintf(stderr, "Unknown command or missing arguments! "\
+                    "Quitting!\n");
+            exit(1);
+        }
+        strncpy(req.name, argv[i++], sizeof(req.name) - 1);
+        if ( req.op == OP_CLEAN ) req.n = atoi(argv[i++]);
+        for (int k = 0; k < nf; ++k) {
+            req.f[k] = atof(argv[i++]);
+        }
+        strncpy(outname, argv[i], sizeof(outname) - 1);
+    }
+
+
+    /* Send the request and read the reply */
+    proto_path(path, sizeof(path), given);
+    int fd = proto_connect(path);
+    if ( fd < 0 ) {
+        fprintf(stderr, "ERROR: No server on \"%s\" !\n", path);
+        exit(1);
+    }
+    if ( proto_write(fd, &req, sizeof(req)) != 0 ||\
+         proto_read(fd, &rep, sizeof(rep)) != 0 || rep.magic != PROTO_MAGIC ) {
+        fprintf(stderr, "ERROR: No reply from the server !\n");
+        exit(1);
+    }
+    char* payload = malloc(rep.size + 1);
+    if ( rep.size > 0 && proto_read(fd, payload, rep.size) != 0 ) {
+        fprintf(stderr, "ERROR: Incomplete reply from the server !\n");
+        exit(1);
+    }
+    payload[rep.size] = '\0';
+    close(fd);
+
+    // Failed?
+    if ( rep.status != 0 ) {
+        fprintf(stderr, "ERROR: %s !\n", rep.msg);
+        exit(1);
+    }
+
+
+    /* Write the answer */
+    if ( rep.msg[0] != '\0' ) fprintf(stderr, "%s\n", rep.msg);
+    if ( rep.ncol == 0 ) {
+        fputs(payload, stdout);
+    }
+    else {
+        FILE* outfile = stdout;
+        if ( strcmp(outname, "-") != 0 ) outfile = fopen(outname, "w");
+        if ( outfile == NULL ) {
+            fprintf(stderr, "ERROR: Cannot write to \"%s\" !\n", outname);
+            exit(1);
+        }
+
+        double* col = (double*) payload;
+        size_t n = rep.nrow;
+        for (size_t r = 0; r < n; ++r) {
+            // CLEAN: As the log of fclean.x
+            if ( req.op == OP_CLEAN )
+                fprintf(outfile, " %6li %15.6lf %12.6lg %12.6lf %12.6lf\n",\
+                        r+1, col[r], col[n + r], col[2*n + r], col[3*n + r]);
+            else {
+                fprintf(outfile, "%15.9e", col[r]);
+                for (size_t c = 1; c < rep.ncol; ++c) {
+                    fprintf(outfile, " %18.9e", col[c*n + r]);
+                }
+                fprintf(outfile, "\n");
+            }
+        }
+        if ( outfile != stdout ) fclose(outfile);
+    }
+
+
+    /* Done! */
+    free(payload);
+    return 0;
+}
@@ -0,0 +1,744 @@
+/*  ~~~ Time Series Analysis -- Analysis Server ~~~
+ *
+ * Usage:
+ * tsad.x [options]
+ *
+ * Resident server: Time series are loaded once and kept in memory together
+ * with the products calculated from them (spectra, window functions and
+ * sums of the window). Requests for spectra, CLEAN, window functions and
+ * filters are answered over a local Unix domain socket (see protocol.h for
+ * the messages, and tsac.c for the client). Independent requests run at the
+ * same time on a fixed pool of worker threads; each worker uses its share
+ * of the OpenMP threads for the calculations.
+ *
+ * A spectrum of a data set is reused by later requests on the same (or a
+ * contained) frequency grid, e.g. spectra and filters of different bands
+ * in a range already calculated. The last PRODUCTS products per data set
+ * are kept.
+ *
+ * Options:
+ *  -s socket: Path of the socket (default: $TSA_SOCKET or /tmp/tsad.sock).
+ *  -workers W: Number of requests handled at the same time (default 2).
+ *  -q: Quiet-mode. No log of the requests to the console.
+ *  -engine {auto|direct|fft|zoom|float}: Engine for the power spectra (see
+ *         powerspec.c).
+ *  -trig {exact|1e-10|1e-6}: Accuracy of sin/cos in the direct sums (see
+ *         powerspec.c).
+ *
+ * Note:
+ * The number of OpenMP threads ("OMP_NUM_THREADS") is divided among the
+ * workers. Stop the server with "tsac.x stop".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <omp.h>
+
+#include "fileio.h"
+#include "arrlib.h"
+#include "tsfourier.h"
+#include "window.h"
+#include "pass.h"
+#include "series.h"
+#include "protocol.h"
+
+#define PI2micro 6.28318530717958647692528676655900576839433879875e-6
+
+// Max. number of data sets, products per data set and waiting requests
+#define MAXSETS 32
+#define PRODUCTS 16
+#define QUEUELEN 256
+
+// Kinds of products
+#define PROD_SPEC 1    // key = {f0, rate}: alpha, beta
+#define PROD_WIN 2     // key = {f0, limit, rate}: window
+#define PROD_WINSUM 3  // key = {low, high, rate}: sum of the window
+
+// Max. deviation (in steps) for two frequency grids to be considered equal
+#define GRIDTOL 1e-6
+
+// Names of the operations (for the log)
+static char* opname[] = {"unknown", "load", "unload", "list", "spectrum",\
+                         "window", "clean", "filter", "stop"};
+
+// Product calculated from a data set
+struct product {
+    int kind;
+    double key[3];
+    size_t M;
+    double* a;
+    double* b;
+};
+
+// Resident data set (the data is stored with the mean subtracted)
+struct dataset {
+    char name[64];
+    char path[256];
+    double* time;
+    double* flux;
+    double* weight;
+    size_t N;
+    int useweight;
+    int unit;
+    double fmean;
+    double nyquist;
+
+    // Products (guarded by the lock)
+    pthread_mutex_t lock;
+    struct product prod[PRODUCTS];
+    int next;
+};
+
+// Data sets -- requests hold the lock for reading, (un)loading for writing
+static struct dataset* sets[MAXSETS];
+static pthread_rwlock_t setlock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Queue of connections waiting for a worker
+static int queue[QUEUELEN];
+static int qhead = 0;
+static int qlen = 0;
+static pthread_mutex_t qlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t qcond = PTHREAD_COND_INITIALIZER;
+
+// Server
+static int listenfd = -1;
+static volatile int stopping = 0;
+static int quiet = 0;
+static int ompthreads = 1;
+
+void* worker(void *arg);
+
+void serve(int fd);
+
+void push(int fd);
+
+void* fail(struct reply *rep, char *msg);
+
+struct dataset* findset(char name[]);
+
+void freeset(struct dataset *ds);
+
+int getproduct(struct dataset *ds, int kind, double key[], size_t M,\
+               double a[], double b[]);
+
+void putproduct(struct dataset *ds, int kind, double key[], size_t M,\
+                double a[], double b[]);
+
+void getspec(struct dataset *ds, double f0, double rate, size_t M,\
+             double alpha[], double beta[]);
+
+void* op_load(struct request *req, struct reply *rep);
+
+void* op_unload(struct request *req, struct reply *rep);
+
+void* op_list(struct request *req, struct reply *rep);
+
+void* op_spectrum(struct dataset *ds, struct request *req, struct reply *rep);
+
+void* op_window(struct dataset *ds, struct request *req, struct reply *rep);
+
+void* op_clean(struct dataset *ds, struct request *req, struct reply *rep);
+
+void* op_filter(struct dataset *ds, struct request *req, struct reply *rep);
+
+
+int main(int argc, char *argv[])
+{
+    /* Important definitions */
+    char given[256] = "";
+    char path[256];
+    int workers = 2;
+    int engine = 0;
+    int trig = 0;
+
+
+    /* Process command line arguments */
+    for (int i = 1; i < argc; ++i) {
+        if ( strcmp(argv[i], "-q" ) == 0 ) {
+            quiet = 1;
+        }
+        else if ( strcmp(argv[i], "-s" ) == 0 && i + 1 < argc ) {
+            i++;
+            strncpy(given, argv[i], 255);
+        }
+        else if ( strcmp(argv[i], "-workers" ) == 0 && i + 1 < argc ) {
+            i++;
+            workers = atoi(argv[i]);
+            if ( workers < 1 ) workers = 1;
+        }
+        else if ( strcmp(argv[i], "-trig" ) == 0 && i + 1 < argc ) {
+            i++;
+            if ( strcmp(argv[i], "exact" ) == 0 ) trig = 0;
+            else if ( strcmp(argv[i], "1e-10" ) == 0 ) trig = 1;
+            else if ( strcmp(argv[i], "1e-6" ) == 0 ) trig = 2;
+            else {
+                fprintf(stderr, "Unknown accuracy \"%s\"! Quitting!\n",\
+                        argv[i]);
+                exit(1);
+            }
+        }
+        else if ( strcmp(argv[i], "-engine" ) == 0 && i + 1 < argc ) {
+            i++;
+            if ( strcmp(argv[i], "auto" ) == 0 ) engine = 0;
+            else if ( strcmp(argv[i], "direct" ) == 0 ) engine = 1;
+            else if ( strcmp(argv[i], "fft" ) == 0 ) engine = 2;
+            else if ( strcmp(argv[i], "zoom" ) == 0 ) engine = 3;
+            else if ( strcmp(argv[i], "float" ) == 0 ) engine = 4;
+            else {
+                fprintf(stderr, "Unknown engine \"%s\"! Quitting!\n",\
+                        argv[i]);
+                exit(1);
+            }
+        }
+        else {
+            fprintf(stderr, "usage: %s  [-s socket] [-workers W] [-q]"\
+                    " [-engine name] [-trig accuracy]\n", argv[0]);
+            exit(1);
+        }
+    }
+    fourier_setengine(engine);
+    fourier_settrig(trig);
+
+    // Share the OpenMP threads among the workers
+    ompthreads = omp_get_max_threads() / workers;
+    if ( ompthreads < 1 ) ompthreads = 1;
+
+    // A client leaving early must not stop the server
+    signal(SIGPIPE, SIG_IGN);
+
+
+    /* Open the socket */
+    proto_path(path, sizeof(path), given);
+    listenfd = proto_listen(path);
+    if ( listenfd < 0 ) {
+        fprintf(stderr, "ERROR: Cannot listen on \"%s\" !\n", path);
+        exit(1);
+    }
+    if ( quiet == 0 ) {
+        printf("\nAnalysis server listening on \"%s\" ...\n", path);
+        printf(" -- INFO: %i workers with %i threads each\n", workers,\
+               ompthreads);
+        fflush(stdout);
+    }
+
+
+    /* Serve until stopped */
+    pthread_t* threads = malloc(workers * sizeof(pthread_t));
+    for (int w = 0; w < workers; ++w) {
+        pthread_create(&threads[w], NULL, worker, NULL);
+    }
+    while ( stopping == 0 ) {
+        int fd = accept(listenfd, NULL, NULL);
+        if ( fd < 0 ) {
+            if ( errno == EINTR && stopping == 0 ) continue;
+            break;
+        }
+        push(fd);
+    }
+
+    // Let the workers finish the waiting requests
+    for (int w = 0; w < workers; ++w) {
+        push(-1);
+    }
+    for (int w = 0; w < workers; ++w) {
+        pthread_join(threads[w], NULL);
+    }
+    close(listenfd);
+    unlink(path);
+
+
+    /* Free data */
+    for (int s = 0; s < MAXSETS; ++s) {
+        if ( sets[s] != NULL ) freeset(sets[s]);
+    }
+    free(threads);
+
+
+    /* Done! */
+    if ( quiet == 0 ) printf("Done!\n\n");
+    return 0;
+}
+
+
+/* Worker: Take connections from the queue until -1 is found */
+void* worker(void *arg)
+{
+    omp_set_num_threads(ompthreads);
+    while ( 1 ) {
+        pthread_mutex_lock(&qlock);
+        while ( qlen == 0 ) pthread_cond_wait(&qcond, &qlock);
+        int fd = queue[qhead];
+        qhead = (qhead + 1) % QUEUELEN;
+        qlen--;
+        pthread_cond_broadcast(&qcond);
+        pthread_mutex_unlock(&qlock);
+
+        if ( fd < 0 ) break;
+        serve(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+
+/* Put a connection in the queue (waits if it is full) */
+void push(int fd)
+{
+    pthread_mutex_lock(&qlock);
+    while ( qlen == QUEUELEN ) pthread_cond_wait(&qcond, &qlock);
+    queue[(qhead + qlen) % QUEUELEN] = fd;
+    qlen++;
+    pthread_cond_broadcast(&qcond);
+    pthread_mutex_unlock(&qlock);
+}
+
+
+/* Answer one request on the connection */
+void serve(int fd)
+{
+    struct request req;
+    struct reply rep;
+    void* payload = NULL;
+    double start = omp_get_wtime();
+
+    memset(&rep, 0, sizeof(rep));
+    rep.magic = PROTO_MAGIC;
+    if ( proto_read(fd, &req, sizeof(req)) != 0 ) return;
+    req.name[sizeof(req.name) - 1] = '\0';
+    req.path[sizeof(req.path) - 1] = '\0';
+
+    if ( req.magic != PROTO_MAGIC ) {
+        payload = fail(&rep, "Unknown protocol");
+    }
+    else if ( req.op == OP_LOAD ) {
+        payload = op_load(&req, &rep);
+    }
+    else if ( req.op == OP_UNLOAD ) {
+        payload = op_unload(&req, &rep);
+    }
+    else if ( req.op == OP_LIST ) {
+        payload = op_list(&req, &rep);
+    }
+    else if ( req.op == OP_STOP ) {
+        stopping = 1;
+        shutdown(listenfd, SHUT_RDWR);
+        snprintf(rep.msg, sizeof(rep.msg), "Stopping");
+    }
+    else {
+        // Calculations on a data set
+        pthread_rwlock_rdlock(&setlock);
+        struct dataset* ds = findset(req.name);
+        if ( ds == NULL )
+            payload = fail(&rep, "Unknown data set");
+        else if ( req.op == OP_SPECTRUM )
+            payload = op_spectrum(ds, &req, &rep);
+        else if ( req.op == OP_WINDOW )
+            payload = op_window(ds, &req, &rep);
+        else if ( req.op == OP_CLEAN )
+            payload = op_clean(ds, &req, &rep);
+        else if ( req.op == OP_FILTER )
+            payload = op_filter(ds, &req, &rep);
+        else
+            payload = fail(&rep, "Unknown operation");
+        pthread_rwlock_unlock(&setlock);
+    }
+
+    // Send the reply
+    if ( proto_write(fd, &rep, sizeof(rep)) == 0 && rep.size > 0 )
+        proto_write(fd, payload, rep.size);
+    free(payload);
+
+    if ( quiet == 0 ) {
+        printf(" - Request %s \"%s\": %s (%.3lf s)\n",\
+               opname[( req.op <= OP_STOP ) ? req.op : 0], req.name,\
+               ( rep.status == 0 ) ? "OK" : rep.msg, omp_get_wtime() - start);
+        fflush(stdout);
+    }
+}
+
+
+/* Mark the reply as failed -- returns no payload */
+void* fail(struct reply *rep, char *msg)
+{
+    rep->status = 1;
+    rep->ncol = 0;
+    rep->nrow = 0;
+    rep->size = 0;
+    snprintf(rep->msg, sizeof(rep->msg), "%s", msg);
+    return NULL;
+}
+
+
+/* Find data set by name (the caller holds setlock) */
+struct dataset* findset(char name[])
+{
+    for (int s = 0; s < MAXSETS; ++s) {
+        if ( sets[s] != NULL && strcmp(sets[s]->name, name) == 0 )
+            return sets[s];
+    }
+    return NULL;
+}
+
+
+/* Free a data set and its products */
+void freeset(struct dataset *ds)
+{
+    for (int p = 0; p < PRODUCTS; ++p) {
+        free(ds->prod[p].a);
+        free(ds->prod[p].b);
+    }
+    pthread_mutex_destroy(&ds->lock);
+    free(ds->time);
+    free(ds->flux);
+    free(ds->weight);
+    free(ds);
+}
+
+
+/* Look for a product and copy it (or the slice on the grid of a spectrum)
+ *  --> Returns 1 if found
+ */
+int getproduct(struct dataset *ds, int kind, double key[], size_t M,\
+               double a[], double b[])
+{
+    int found = 0;
+    pthread_mutex_lock(&ds->lock);
+    for (int p = 0; p < PRODUCTS && found == 0; ++p) {
+        struct product* pr = &ds->prod[p];
+        if ( pr->kind != kind ) continue;
+
+        // Spectra: Same rate and the grid is contained
+        if ( kind == PROD_SPEC ) {
+            if ( fabs(pr->key[1] - key[1]) > 1e-12 * key[1] ) continue;
+            double k = (key[0] - pr->key[0]) / key[1];
+            double k0 = round(k);
+            if ( fabs(k - k0) > GRIDTOL || k0 < 0 ||\
+                 (size_t) k0 + M > pr->M ) continue;
+            memcpy(a, &pr->a[(size_t) k0], M * sizeof(double));
+            memcpy(b, &pr->b[(size_t) k0], M * sizeof(double));
+            found = 1;
+        }
+        // Others: Identical keys
+        else if ( pr->key[0] == key[0] && pr->key[1] == key[1] &&\
+                  pr->key[2] == key[2] && pr->M == M ) {
+            memcpy(a, pr->a, M * sizeof(double));
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&ds->lock);
+    return found;
+}
+
+
+/* Keep a copy of a product (replacing the oldest) */
+void putproduct(struct dataset *ds, int kind, double key[], size_t M,\
+                double a[], double b[])
+{
+    double* ca = malloc(M * sizeof(double));
+    double* cb = NULL;
+    memcpy(ca, a, M * sizeof(double));
+    if ( b != NULL ) {
+        cb = malloc(M * sizeof(double));
+        memcpy(cb, b, M * sizeof(double));
+    }
+
+    pthread_mutex_lock(&ds->lock);
+    struct product* pr = &ds->prod[ds->next];
+    free(pr->a);
+    free(pr->b);
+    pr->kind = kind;
+    pr->key[0] = key[0];
+    pr->key[1] = key[1];
+    pr->key[2] = key[2];
+    pr->M = M;
+    pr->a = ca;
+    pr->b = cb;
+    ds->next = (ds->next + 1) % PRODUCTS;
+    pthread_mutex_unlock(&ds->lock);
+}
+
+
+/* Spectrum (alpha and beta) at f0 + k*rate, k < M -- reused if possible */
+void getspec(struct dataset *ds, double f0, double rate, size_t M,\
+             double alpha[], double beta[])
+{
+    double key[3] = {f0, rate, 0};
+    if ( getproduct(ds, PROD_SPEC, key, M, alpha, beta) != 0 ) return;
+
+    double* freq = malloc(M * sizeof(double));
+    double* power = malloc(M * sizeof(double));
+    arr_init_linspace(freq, f0, rate, M);
+    fourier(ds->time, ds->flux, ds->weight, freq, ds->N, M, power, alpha,\
+            beta, ds->useweight);
+    putproduct(ds, PROD_SPEC, key, M, alpha, beta);
+    free(freq);
+    free(power);
+}
+
+
+/* Load: Read file `path` as data set `name` (n = unit of the times) */
+void* op_load(struct request *req, struct reply *rep)
+{
+    if ( req->name[0] == '\0' ) return fail(rep, "No name given");
+    FILE* test = fopen(req->path, "r");
+    if ( test == NULL ) return fail(rep, "Cannot open the file");
+    fclose(test);
+    size_t N = countlines(req->path);
+    if ( N < 2 ) return fail(rep, "Too few points in the file");
+
+    // Read and prepare the data
+    struct dataset* ds = calloc(1, sizeof(struct dataset));
+    if ( ds == NULL ) return fail(rep, "Not enough memory");
+    ds->time = malloc(N * sizeof(double));
+    ds->flux = malloc(N * sizeof(double));
+    ds->weight = malloc(N * sizeof(double));
+    double* dt = malloc((N-1) * sizeof(double));
+    if ( ds->time == NULL || ds->flux == NULL || ds->weight == NULL ||\
+         dt == NULL ) {
+        free(ds->time);
+        free(ds->flux);
+        free(ds->weight);
+        free(ds);
+        free(dt);
+        return fail(rep, "Not enough memory for the data set");
+    }
+    strcpy(ds->name, req->name);
+    strcpy(ds->path, req->path);
+    ds->N = N;
+    ds->useweight = req->useweight;
+    ds->unit = req->n;
+    readcols(req->path, ds->time, ds->flux, ds->weight, N, ds->useweight,\
+             0, 0, ds->unit, 1);
+    pthread_mutex_init(&ds->lock, NULL);
+
+    arr_diff(ds->time, dt, N);
+    ds->nyquist = 1.0 / (2.0 * arr_median(dt, N-1)) * 1e6; // microHz !
+    free(dt);
+    ds->fmean = arr_mean(ds->flux, N);
+    arr_sca_add(ds->flux, -ds->fmean, N);
+
+    // Insert (replacing a data set with the same name)
+    int slot = -1;
+    pthread_rwlock_wrlock(&setlock);
+    for (int s = 0; s < MAXSETS; ++s) {
+        if ( sets[s] != NULL && strcmp(sets[s]->name, ds->name) == 0 ) {
+            freeset(sets[s]);
+            sets[s] = NULL;
+        }
+        if ( sets[s] == NULL && slot < 0 ) slot = s;
+    }
+    if ( slot >= 0 ) sets[slot] = ds;
+    pthread_rwlock_unlock(&setlock);
+
+    if ( slot < 0 ) {
+        freeset(ds);
+        return fail(rep, "Too many data sets");
+    }
+    snprintf(rep->msg, sizeof(rep->msg), "Loaded \"%s\": %li points,"\
+             " Nyquist frequency = %.2lf microHz", ds->name, N, ds->nyquist);
+    return NULL;
+}
+
+
+/* Unload: Remove data set `name` (waits for running requests) */
+void* op_unload(struct request *req, struct reply *rep)
+{
+    int found = 0;
+    pthread_rwlock_wrlock(&setlock);
+    for (int s = 0; s < MAXSETS; ++s) {
+        if ( sets[s] != NULL && strcmp(sets[s]->name, req->name) == 0 ) {
+            freeset(sets[s]);
+            sets[s] = NULL;
+            found = 1;
+        }
+    }
+    pthread_rwlock_unlock(&setlock);
+
+    if ( found == 0 ) return fail(rep, "Unknown data set");
+    snprintf(rep->msg, sizeof(rep->msg), "Removed \"%s\"", req->name);
+    return NULL;
+}
+
+
+/* List: One line per data set (name, points, weights, Nyquist, file) */
+void* op_list(struct request *req, struct reply *rep)
+{
+    size_t len = MAXSETS * 512 + 1;
+    char* text = malloc(len);
+    size_t used = 0;
+    text[0] = '\0';
+
+    pthread_rwlock_rdlock(&setlock);
+    for (int s = 0; s < MAXSETS; ++s) {
+        struct dataset* ds = sets[s];
+        if ( ds == NULL ) continue;
+        used += snprintf(&text[used], len - used, "%-20s %10li %2i %12.2lf"\
+                         " %s\n", ds->name, ds->N, ds->useweight,\
+                         ds->nyquist, ds->path);
+    }
+    pthread_rwlock_unlock(&setlock);
+
+    rep->size = used;
+    return text;
+}
+
+
+/* Spectrum: f = {low, high, rate} -> freq, power */
+void* op_spectrum(struct dataset *ds, struct request *req, struct reply *rep)
+{
+    double low = req->f[0];
+    double high = req->f[1];
+    double rate = req->f[2];
+    if ( rate <= 0 || high <= low ) return fail(rep, "Wrong sampling");
+
+    size_t M = arr_util_getstep(low, high, rate);
+    double* out = malloc(2 * M * sizeof(double));
+    double* alpha = malloc(M * sizeof(double));
+    double* beta = malloc(M * sizeof(double));
+    getspec(ds, low, rate, M, alpha, beta);
+
+    arr_init_linspace(out, low, rate, M);
+    for (size_t j = 0; j < M; ++j) {
+        out[M + j] = alpha[j]*alpha[j] + beta[j]*beta[j];
+    }
+    free(alpha);
+    free(beta);
+
+    rep->ncol = 2;
+    rep->nrow = M;
+    rep->size = 2 * M * sizeof(double);
+    return out;
+}
+
+
+/* Window function: f = {f0, limit, rate} -> freq - f0, window */
+void* op_window(struct dataset *ds, struct request *req, struct reply *rep)
+{
+    double f0 = req->f[0];
+    double limit = req->f[1];
+    double rate = req->f[2];
+    if ( rate <= 0 || limit <= 0 ) return fail(rep, "Wrong sampling");
+
+    size_t M = arr_util_getstep(f0 - limit, f0 + limit, rate);
+    double* out = malloc(2 * M * sizeof(double));
+    arr_init_linspace(out, f0 - limit, rate, M);
+
+    double key[3] = {f0, limit, rate};
+    if ( getproduct(ds, PROD_WIN, key, M, &out[M], NULL) == 0 ) {
+        windowfunction(ds->time, out, ds->weight, ds->N, M, f0, &out[M],\
+                       ds->useweight);
+        putproduct(ds, PROD_WIN, key, M, &out[M], NULL);
+    }
+    arr_sca_add(out, -f0, M);
+
+    rep->ncol = 2;
+    rep->nrow = M;
+    rep->size = 2 * M * sizeof(double);
+    return out;
+}
+
+
+/* CLEAN: f = {low, high, rate}, n -> freq, power, alpha, beta per peak
+ *  --> The resident data is not changed
+ */
+void* op_clean(struct dataset *ds, struct request *req, struct reply *rep)
+{
+    double low = req->f[0];
+    double high = req->f[1];
+    double rate = req->f[2];
+    size_t Nclean = ( req->n > 0 ) ? req->n : 0;
+    size_t N = ds->N;
+    if ( rate <= 0 || high <= low ) return fail(rep, "Wrong sampling");
+    if ( Nclean == 0 ) return fail(rep, "No frequencies to CLEAN");
+
+    size_t M = arr_util_getstep(low, high, rate);
+    double* freq = malloc(M * sizeof(double));
+    arr_init_linspace(freq, low, rate, M);
+    struct series* ser = series_prepare(ds->time, ds->flux, ds->weight, N,\
+                                        ds->useweight);
+    double* out = malloc(4 * Nclean * sizeof(double));
+
+    double fmax, alpmax, betmax;
+    for (size_t i = 0; i < Nclean; ++i) {
+        fmax = 0;
+        alpmax = 0;
+        betmax = 0;
+        fouriermax_series(ser, freq, M, &fmax, &alpmax, &betmax);
+        out[i] = fmax;
+        out[Nclean + i] = alpmax*alpmax + betmax*betmax;
+        out[2*Nclean + i] = alpmax;
+        out[3*Nclean + i] = betmax;
+
+        // Remove frequency from time series
+        series_subtract(ser, PI2micro*fmax, alpmax, betmax);
+    }
+    free(freq);
+    series_free(ser);
+
+    rep->ncol = 4;
+    rep->nrow = Nclean;
+    rep->size = 4 * Nclean * sizeof(double);
+    return out;
+}
+
+
+/* Filter: f = {f1, f2, low, high, rate} -> time, data (, weight)
+ *  --> Bandpass between f1 and f2 (see bandpass in pass.c)
+ */
+void* op_filter(struct dataset *ds, struct request *req, struct reply *rep)
+{
+    double f1 = req->f[0];
+    double f2 = req->f[1];
+    double low = req->f[2];
+    double high = req->f[3];
+    double rate = req->f[4];
+    size_t N = ds->N;
+    if ( rate <= 0 || high <= low || f2 <= f1 )
+        return fail(rep, "Wrong sampling");
+
+    // Sum of the window
+    double sumwin;
+    double key[3] = {low, high, rate};
+    if ( getproduct(ds, PROD_WINSUM, key, 1, &sumwin, NULL) == 0 ) {
+        sumwin = windowsum((low + high)/2.0, low, high, rate, ds->time,\
+                           ds->weight, N, ds->useweight, 1);
+        putproduct(ds, PROD_WINSUM, key, 1, &sumwin, NULL);
+    }
+
+    // Spectrum of the band
+    size_t M = arr_util_getstep(f1, f2, rate);
+    double* freq = malloc(M * sizeof(double));
+    double* alpha = malloc(M * sizeof(double));
+    double* beta = malloc(M * sizeof(double));
+    arr_init_linspace(freq, f1, rate, M);
+    getspec(ds, f1, rate, M, alpha, beta);
+
+    // Filtered series (with the mean added again) in the unit of the file
+    int ncol = ( ds->useweight != 0 ) ? 3 : 2;
+    double* out = malloc(ncol * N * sizeof(double));
+    double scaling = 1;
+    if ( ds->unit == 2 ) scaling = 86400.0;
+    else if ( ds->unit == 3 ) scaling = 1e6;
+    for (size_t i = 0; i < N; ++i) {
+        out[i] = ds->time[i] / scaling;
+    }
+    bandseries(ds->time, N, freq, M, alpha, beta, sumwin, &out[N]);
+    arr_sca_add(&out[N], ds->fmean, N);
+    if ( ncol == 3 ) memcpy(&out[2*N], ds->weight, N * sizeof(double));
+    free(freq);
+    free(alpha);
+    free(beta);
+
+    rep->ncol = ncol;
+    rep->nrow = N;
+    rep->size = ncol * N * sizeof(double);
+    return out;
+}
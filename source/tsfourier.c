@@ -8,19 +8,175 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <complex.h>
+#include <stdint.h>
 #include <omp.h>
 
 #include "arrlib.h"
 #include "fmin.h"
+#include "fft.h"
+#include "zoom.h"
+#include "tabtrig.h"
+#include "chunk.h"
+#include "series.h"
 
+#define PI2 6.28318530717958647692528676655900576839433879875
 #define PI2micro 6.28318530717958647692528676655900576839433879875e-6
 #define EPS 1.0e-9
 
-void alpbet(double time[], double flux[], size_t N, double ny, double *alpha, \
-            double *beta);
+// FFT-engine: Max. number of grid points per data point (sparse grids; the
+// grid itself is determined by series_grid)
+#define GRIDFILL 8
 
-void alpbetW(double time[], double flux[], double weight[], size_t N,\
-             double ny, double wsum, double *alpha, double *beta);
+// Zoom-engine: Only used if it reduces the length of the series by this factor
+#define ZOOMGAIN 4
+
+// Engine used for the spectrum: 0 = auto, 1 = direct sums, 2 = FFT, 3 = zoom,
+// 4 = direct sums with single-precision sin/cos
+static int engine = 0;
+
+// Arrays used by the kernels of the direct sums (`wflux` = weight * data)
+struct sumdata {
+    double* time;
+    double* flux;
+    double* weight;
+    double* wflux;
+};
+
+// Accuracy of sin/cos in the direct sums: 0 = exact (C library),
+// 1 = table with max. error 1e-10, 2 = table with max. error 1e-6
+static int trigtier = 0;
+
+void fourier_series(struct series *ser, double freq[], size_t M,\
+                    double power[], double alpha[], double beta[]);
+
+void fouriermax_series(struct series *ser, double freq[], size_t M,\
+                       double *fmax, double *alpmax, double *betmax);
+
+void alpbet(struct series *ser, double ny, double *alpha, double *beta);
+
+void alpbetW(struct series *ser, double ny, double *alpha, double *beta);
+
+void alpbetchunk(struct series *ser, double ny[], size_t M, double alpha[],\
+                 double beta[]);
+
+void alpbetone(struct series *ser, double ny, double *alpha, double *beta);
+
+void maxchunk(struct series *ser, double freq[], size_t M, double *pmax,\
+              double *nymax);
+
+void alpbetkernel(size_t lo, size_t hi, double ny, void *data, double sums[]);
+
+void alpbetWkernel(size_t lo, size_t hi, double ny, void *data, double sums[]);
+
+size_t fftgrid(struct series *ser, size_t M);
+
+int fourierfft(struct series *ser, double freq[], size_t M, double power[],\
+               double alpha[], double beta[]);
+
+int fourierzoom(struct series *ser, double freq[], size_t M, double power[],\
+                double alpha[], double beta[]);
+
+int fouriertable(struct series *ser, double freq[], size_t M, double power[],\
+                 double alpha[], double beta[]);
+
+int fourierfloat(struct series *ser, double freq[], size_t M, double power[],\
+                 double alpha[], double beta[]);
+
+void alpbetF(double tc[], double flux[], double weight[], size_t N,\
+             double ny, double wsum, int useweight, double *alpha,\
+             double *beta);
+
+int maxspectrum(struct series *ser, double freq[], size_t M, double *nymax);
+
+void lscoeffs(double complex x, double complex z, double wsum, double *alpha,\
+              double *beta);
+
+
+/* Select the engine used by fourier()
+ *  - 0: Automatic. FFT if the data is on a cadence grid, otherwise direct
+ *       (the programs choose from the cost model in tune.c instead)
+ *  - 1: Direct sums (alpbet) for all data
+ *  - 2: FFT -- falls back to the direct sums if the data is not gridded
+ *  - 3: Zoom (heterodyne and decimate) for narrow bands -- falls back to the
+ *       FFT or direct sums if the band is too wide to gain anything
+ *  - 4: Direct sums with single-precision sin/cos (also used by fouriermax
+ *       and windowfunction)
+ */
+void fourier_setengine(int choice)
+{
+    engine = choice;
+}
+
+
+/* Return the engine selected for fourier() */
+int fourier_getengine(void)
+{
+    return engine;
+}
+
+
+/* Return the accuracy of sin/cos selected for fourier() */
+int fourier_gettrig(void)
+{
+    return trigtier;
+}
+
+
+/* Select the accuracy of sin/cos in the direct sums of fourier()
+ *  - 0: Exact (the C library)
+ *  - 1: Table with max. error 1e-10
+ *  - 2: Table with max. error 1e-6
+ * Returns the measured max. error of the table (0 for exact).
+ */
+double fourier_settrig(int tier)
+{
+    trigtier = tier;
+    if ( tier == 0 ) return 0;
+    tabtrig_init(tier);
+    return tabtrig_maxerror();
+}
+
+
+/* Length of the cadence grid used by the FFT-engine
+ *  --> Returns 0 if the times are not on a grid (see series_grid), or the
+ *      grid is too sparse (more than GRIDFILL points per data point). The
+ *      engine is only used for M > 1 equidistant frequencies.
+ */
+size_t fourier_fftgrid(double time[], size_t N, size_t M)
+{
+    struct series ser;
+    series_wrap(&ser, time, NULL, NULL, N, 0);
+    size_t L = fftgrid(&ser, M);
+    series_free(&ser);
+    return L;
+}
+
+
+// Length of the cadence grid of a series for the FFT-engine (as
+// fourier_fftgrid; the grid is kept with the series)
+size_t fftgrid(struct series *ser, size_t M)
+{
+    double t0, dt;
+    size_t L = series_grid(ser, &t0, &dt);
+    if ( L == 0 || L > GRIDFILL * ser->N || M < 2 ) return 0;
+    return L;
+}
+
+
+/* Number of bins used by the zoom-engine for M frequencies in steps of df
+ * (in microHz)
+ *  --> Returns 0 if the band is too wide to shorten the series by at least
+ *      ZOOMGAIN (the sums at 2ny cover a band twice as wide)
+ */
+size_t fourier_zoombins(double time[], size_t N, double df, size_t M)
+{
+    double tbin;
+    if ( M < 2 ) return 0;
+    size_t L = zoom_nbins(time, N, 2 * df * PI2micro, M, &tbin);
+    if ( ZOOMGAIN * L > N ) return 0;
+    return L;
+}
 
 
 /* Calculate the fourier transform of time series
@@ -36,70 +192,315 @@ void alpbetW(double time[], double flux[], double weight[], size_t N,\
  *  - `alpha`    : OUTPUT -- Array with alphas
  *  - `beta`     : OUTPUT -- Array with betas
  *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ *
+ * Note: Uses the exact FFT-based sums for data on a cadence grid, unless the
+ *       direct engine is selected (see fourier_setengine). The direct sums
+ *       use table-driven sin/cos if selected (see fourier_settrig). With
+ *       few frequencies compared to the number of threads, the time series
+ *       is split among the threads (with identical results).
  */
 void fourier(double time[], double flux[], double weight[], double freq[],\
              size_t N, size_t M, double power[], double alpha[], double beta[],\
              int useweight)
+{
+    struct series ser;
+    series_wrap(&ser, time, flux, weight, N, useweight);
+    fourier_series(&ser, freq, M, power, alpha, beta);
+    series_free(&ser);
+}
+
+
+/* Calculate the fourier transform of a prepared time series (see series.c)
+ *  --> As fourier(), but the sum of the weights, weight * data, the cadence
+ *      grid and the centred times are taken from the series instead of
+ *      being calculated in every call
+ */
+void fourier_series(struct series *ser, double freq[], size_t M,\
+                    double power[], double alpha[], double beta[])
 {
     // Local variables
     double alp = 0;
     double bet = 0;
     double ny = 0;
     size_t i;
+    size_t N = ser->N;
+    int useweight = ser->useweight;
 
-    // Call functions with or without weights
-    if ( useweight == 0 ) {
-        // Make parallel loop over all test frequencies
-        #pragma omp parallel default(shared) private(alp, bet, ny)
-        {
-            #pragma omp for schedule(static)
-            for (i = 0; i < M; ++i) {
-                // Current frequency
-                ny = freq[i] * PI2micro;
-
-                // Calculate alpha and beta
-                alpbet(time, flux, N, ny, &alp, &bet);
-                
-                // Store alpha, beta and power
-                alpha[i] = alp;
-                beta[i] = bet;
-                power[i] = alp*alp + bet*bet;
-            }
+    // Try the single-precision, zoom- or FFT-engine first
+    if ( engine == 4 ) {
+        fourierfloat(ser, freq, M, power, alpha, beta);
+        return;
+    }
+    if ( engine == 3 ) {
+        if ( fourierzoom(ser, freq, M, power, alpha, beta) != 0 ) return;
+    }
+    if ( engine != 1 ) {
+        if ( fourierfft(ser, freq, M, power, alpha, beta) != 0 ) return;
+    }
+    if ( trigtier != 0 ) {
+        if ( fouriertable(ser, freq, M, power, alpha, beta) != 0 ) return;
+    }
+
+    // Few frequencies: Split the time series among the threads instead
+    if ( chunk_usetime(N, M) ) {
+        double* nys = malloc(M * sizeof(double));
+        for (i = 0; i < M; ++i) {
+            nys[i] = freq[i] * PI2micro;
+        }
+        alpbetchunk(ser, nys, M, alpha, beta);
+        for (i = 0; i < M; ++i) {
+            power[i] = alpha[i]*alpha[i] + beta[i]*beta[i];
         }
+        free(nys);
+        return;
     }
-    else {
-        // Sum of all weights
-        double sumweights = arr_sum(weight, N);
 
-        // Make parallel loop over all test frequencies
-        #pragma omp parallel default(shared) private(alp, bet, ny)
-        {
-            #pragma omp for schedule(static)
-            for (i = 0; i < M; ++i) {
-                // Current frequency
-                ny = freq[i] * PI2micro;
-
-                // Calculate alpha and beta
-                alpbetW(time, flux, weight, N, ny, sumweights, &alp, &bet);
-                
-                // Store alpha, beta and power
-                alpha[i] = alp;
-                beta[i] = bet;
-                power[i] = alp*alp + bet*bet;
-            }
+    // Make parallel loop over all test frequencies
+    #pragma omp parallel default(shared) private(alp, bet, ny)
+    {
+        // Copy of the series on the node of this thread (see series.c)
+        struct series* loc = series_local(ser);
+
+        #pragma omp for schedule(static)
+        for (i = 0; i < M; ++i) {
+            // Current frequency
+            ny = freq[i] * PI2micro;
+
+            // Calculate alpha and beta (with or without weights)
+            if ( useweight == 0 )
+                alpbet(loc, ny, &alp, &bet);
+            else
+                alpbetW(loc, ny, &alp, &bet);
+
+            // Store alpha, beta and power
+            alpha[i] = alp;
+            beta[i] = bet;
+            power[i] = alp*alp + bet*bet;
         }
     }
 }
 
 
-// Calculate alpha and beta coefficients
-void alpbet(double time[], double flux[], size_t N, double ny, double *alpha, \
-            double *beta)
+/* Calculate the fourier transform using FFTs on the cadence grid
+ *  --> Returns 0 (and does nothing) if the times are not integer multiples of
+ *      a cadence or the frequencies are not equidistant
+ *
+ * The sums of alpbetW are given by the Fourier sums
+ *     X(ny) = sum_k weight_k flux_k exp(i ny t_k)  ->  s = Im X, c = Re X
+ *     Z(ny) = sum_k weight_k exp(i ny t_k)  ->  cc = (wsum + Re Z(2ny))/2 and
+ *                                               sc = Im Z(2ny)/2
+ * which are evaluated for all frequencies by chirp-z transforms of the
+ * zero-filled series on the grid. The result is identical to the direct sums
+ * (to rounding error). Without weights, all weights are 1.
+ */
+int fourierfft(struct series *ser, double freq[], size_t M, double power[],\
+               double alpha[], double beta[])
+{
+    double* time = ser->time;
+    double* flux = ser->flux;
+    double* weight = ser->weight;
+    size_t N = ser->N;
+    int useweight = ser->useweight;
+
+    // Check the sampling
+    double t0, dt;
+    if ( M < 2 || arr_util_isuniform(freq, M, 1.0e-6) == 0 ) return 0;
+    size_t L = fftgrid(ser, M);
+    if ( L == 0 ) return 0;
+    series_grid(ser, &t0, &dt);
+
+    // Put the (weighted) data and the weights on the grid
+    double complex* data = calloc(L, sizeof(double complex));
+    double complex* mask = calloc(L, sizeof(double complex));
+    double wsum = 0;
+    double w = 1.0;
+    size_t n;
+    for (size_t k = 0; k < N; ++k) {
+        n = (size_t) llround((time[k] - t0) / dt);
+        if ( useweight != 0 ) w = weight[k];
+        data[n] += w * flux[k];
+        mask[n] += w;
+        wsum += w;
+    }
+
+    // Fourier sums at all ny and 2ny (angles per grid step)
+    double nyfirst = freq[0] * PI2micro;
+    double dny = (freq[M-1] - freq[0]) / (M-1) * PI2micro;
+    double complex* X = malloc(M * sizeof(double complex));
+    double complex* Z = malloc(M * sizeof(double complex));
+    czt(data, L, nyfirst * dt, dny * dt, M, X);
+    czt(mask, L, 2 * nyfirst * dt, 2 * dny * dt, M, Z);
+
+    // Calculate the coefficients
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0; i < M; ++i) {
+        // Shift of the time origin from zero to t0
+        double ny = nyfirst + i * dny;
+        double complex x = X[i] * cexp(I * ny * t0);
+        double complex z = Z[i] * cexp(I * 2 * ny * t0);
+
+        // Calculate coefficients
+        lscoeffs(x, z, wsum, &alpha[i], &beta[i]);
+        power[i] = alpha[i]*alpha[i] + beta[i]*beta[i];
+    }
+
+    // Done
+    free(data);
+    free(mask);
+    free(X);
+    free(Z);
+    return 1;
+}
+
+
+/* Calculate the fourier transform by heterodyning and decimation
+ *  --> Returns 0 (and does nothing) if the frequencies are not equidistant,
+ *      or the band is too wide to shorten the series significantly
+ *
+ * Uses the same Fourier sums X(ny) and Z(2ny) as the FFT-engine, but they are
+ * calculated by zoomsum (see zoom.c) from a short series mixed down by the
+ * centre of the band. Works for any sampling of the times.
+ */
+int fourierzoom(struct series *ser, double freq[], size_t M, double power[],\
+                double alpha[], double beta[])
+{
+    double* time = ser->time;
+    double* flux = ser->flux;
+    double* weight = ser->weight;
+    size_t N = ser->N;
+    int useweight = ser->useweight;
+
+    // Check the sampling and the gain
+    if ( M < 2 || arr_util_isuniform(freq, M, 1.0e-6) == 0 ) return 0;
+    double nyfirst = freq[0] * PI2micro;
+    double dny = (freq[M-1] - freq[0]) / (M-1) * PI2micro;
+    if ( fourier_zoombins(time, N, (freq[M-1] - freq[0]) / (M-1), M) == 0 )
+        return 0;
+
+    // The (weighted) data and the weights
+    double* data = malloc(N * sizeof(double));
+    double* mask = malloc(N * sizeof(double));
+    double wsum = 0;
+    double w = 1.0;
+    for (size_t k = 0; k < N; ++k) {
+        if ( useweight != 0 ) w = weight[k];
+        data[k] = w * flux[k];
+        mask[k] = w;
+        wsum += w;
+    }
+
+    // Fourier sums at all ny and 2ny
+    double complex* X = malloc(M * sizeof(double complex));
+    double complex* Z = malloc(M * sizeof(double complex));
+    zoomsum(time, data, N, nyfirst, dny, M, X);
+    zoomsum(time, mask, N, 2 * nyfirst, 2 * dny, M, Z);
+
+    // Calculate the coefficients
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0; i < M; ++i) {
+        lscoeffs(X[i], Z[i], wsum, &alpha[i], &beta[i]);
+        power[i] = alpha[i]*alpha[i] + beta[i]*beta[i];
+    }
+
+    // Done
+    free(data);
+    free(mask);
+    free(X);
+    free(Z);
+    return 1;
+}
+
+
+/* Calculate the fourier transform using table-driven sin/cos
+ *  --> Returns 0 (and does nothing) if the frequencies are not equidistant
+ *
+ * Same sums as alpbetW, but the phases are accumulated along the frequencies
+ * in fixed point and sin/cos are taken from a table (see tabtrig.c).
+ */
+int fouriertable(struct series *ser, double freq[], size_t M, double power[],\
+                 double alpha[], double beta[])
+{
+    // Check the sampling
+    if ( M < 2 || arr_util_isuniform(freq, M, 1.0e-6) == 0 ) return 0;
+    double df = (freq[M-1] - freq[0]) / (M-1);
+    double wsum = ser->wsum;
+
+    // Calculate the sums
+    //  --> Stored in the output (alpha, beta, power) and one extra array
+    double* sc = malloc(M * sizeof(double));
+    tabtrig_sums(ser->time, ser->flux, ser->weight, ser->N, freq[0], df, M,\
+                 ser->useweight, alpha, beta, power, sc);
+
+    // Calculate the coefficients
+    double s, c, cc, ss, D;
+    for (size_t i = 0; i < M; ++i) {
+        s = alpha[i];
+        c = beta[i];
+        cc = power[i];
+        ss = wsum - cc;
+        D = ss*cc - sc[i]*sc[i];
+        alpha[i] = (s * cc - c * sc[i])/D;
+        beta[i]  = (c * ss - s * sc[i])/D;
+        power[i] = alpha[i]*alpha[i] + beta[i]*beta[i];
+    }
+
+    // Done
+    free(sc);
+    return 1;
+}
+
+
+/* Calculate the fourier transform using single-precision sin/cos
+ *
+ * The times are centred around the middle of the series, so the phases are
+ * small and accurate. The phases are reduced to [-pi, pi] in double
+ * precision, while sin/cos are taken in single precision and summed in
+ * double precision. The coefficients are rotated back to the time origin.
+ */
+int fourierfloat(struct series *ser, double freq[], size_t M, double power[],\
+                 double alpha[], double beta[])
+{
+    // Centred times (from the series) and sum of weights
+    double* tc = series_ctime(ser);
+    double tmid = ser->tmid;
+    double wsum = ser->wsum;
+    double* flux = ser->flux;
+    double* weight = ser->weight;
+    size_t N = ser->N;
+    int useweight = ser->useweight;
+
+    // Make parallel loop over all test frequencies
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0; i < M; ++i) {
+        double ny = freq[i] * PI2micro;
+        double alp, bet, phi;
+
+        // Calculate alpha and beta relative to the middle of the series
+        alpbetF(tc, flux, weight, N, ny, wsum, useweight, &alp, &bet);
+
+        // Shift the phase back to the time origin
+        phi = ny * tmid;
+        alpha[i] = alp * cos(phi) + bet * sin(phi);
+        beta[i]  = bet * cos(phi) - alp * sin(phi);
+        power[i] = alp*alp + bet*bet;
+    }
+
+    // Done
+    return 1;
+}
+
+
+// Calculate alpha and beta coefficients -- SINGLE-PRECISION SIN/COS
+//  --> For times `tc` centred around the middle of the series
+void alpbetF(double tc[], double flux[], double weight[], size_t N,\
+             double ny, double wsum, int useweight, double *alpha,\
+             double *beta)
 {
     // Auxiliary
-    double sn, cn, D;
-    
-    // Sums
+    double x, w, D;
+    float sn, cn;
+
+    // Sums (double precision)
     double s = 0;
     double c = 0;
     double cc = 0;
@@ -108,21 +509,22 @@ void alpbet(double time[], double flux[], size_t N, double ny, double *alpha, \
 
     // Loop over the time series
     for (size_t i = 0; i < N; ++i) {
-        // Pre-calculate sin, cos of point
-        sn = sin(ny * time[i]);
-        cn = cos(ny * time[i]);
-
-        // Calculate sin, cos terms
-        s += flux[i] * sn;
-        c += flux[i] * cn;
-
-        // Calculate squared and cross terms
-        cc += cn * cn;
-        sc += sn * cn;
+        // Phase reduced to [-pi, pi] and sin, cos of point
+        x = ny * tc[i];
+        x -= PI2 * rint(x / PI2);
+        sn = sinf((float) x);
+        cn = cosf((float) x);
+
+        // Calculate sin, cos terms and the squared and cross terms
+        w = (useweight != 0) ? weight[i] : 1.0;
+        s += w * flux[i] * sn;
+        c += w * flux[i] * cn;
+        cc += w * cn * cn;
+        sc += w * sn * cn;
     }
 
     // Calculate ss from cc
-    ss = N - cc;
+    ss = wsum - cc;
 
     // Calculate coefficients
     D = ss*cc - sc*sc;
@@ -131,42 +533,200 @@ void alpbet(double time[], double flux[], size_t N, double ny, double *alpha, \
 }
 
 
+// Calculate alpha and beta coefficients from the Fourier sums of the data,
+// x = X(ny), and of the weights, z = Z(2ny) (see fourierfft)
+void lscoeffs(double complex x, double complex z, double wsum, double *alpha,\
+              double *beta)
+{
+    // Sums as in alpbetW
+    double s = cimag(x);
+    double c = creal(x);
+    double cc = 0.5 * (wsum + creal(z));
+    double sc = 0.5 * cimag(z);
+    double ss = wsum - cc;
+
+    // Calculate coefficients
+    double D = ss*cc - sc*sc;
+    *alpha = (s * cc - c * sc)/D;
+    *beta  = (c * ss - s * sc)/D;
+}
+
+
+// Calculate alpha and beta coefficients
+void alpbet(struct series *ser, double ny, double *alpha, double *beta)
+{
+    // Auxiliary
+    double D;
+    
+    // Sums (s, c, cc, sc) over the chunks of the time series
+    double sums[4];
+    struct sumdata data = {ser->time, ser->flux, NULL, NULL};
+    chunk_sums(alpbetkernel, &data, ser->N, ny, 4, sums);
+
+    // Calculate ss from cc
+    double ss = ser->N - sums[2];
+
+    // Calculate coefficients
+    D = ss*sums[2] - sums[3]*sums[3];
+    *alpha = (sums[0] * sums[2] - sums[1] * sums[3])/D;
+    *beta  = (sums[1] * ss - sums[0] * sums[3])/D;
+}
+
+
 // Calculate alpha and beta coefficients  -- USING WEIGHTS
-void alpbetW(double time[], double flux[], double weight[], size_t N,\
-             double ny, double wsum, double *alpha, double *beta)
+void alpbetW(struct series *ser, double ny, double *alpha, double *beta)
 {
     // Auxiliary
-    double sn, cn, D;
+    double D;
+    
+    // Sums (s, c, cc, sc) over the chunks of the time series
+    double sums[4];
+    //  --> Over the padding too (zero weight, see series.c)
+    struct sumdata data = {ser->time, ser->flux, ser->weight, ser->wflux};
+    chunk_sums(alpbetWkernel, &data, ser->Npad, ny, 4, sums);
+
+    // Calculate ss from cc
+    double ss = ser->wsum - sums[2];
+
+    // Calculate coefficients
+    D = ss*sums[2] - sums[3]*sums[3];
+    *alpha = (sums[0] * sums[2] - sums[1] * sums[3])/D;
+    *beta  = (sums[1] * ss - sums[0] * sums[3])/D;
+}
+
+
+// Calculate alpha and beta coefficients for M frequencies, with the time
+// series split among the threads (identical to alpbet/alpbetW)
+void alpbetchunk(struct series *ser, double ny[], size_t M, double alpha[],\
+                 double beta[])
+{
+    double* sums = malloc(4 * M * sizeof(double));
+    struct sumdata data = {ser->time, ser->flux, ser->weight, ser->wflux};
+    if ( ser->useweight == 0 )
+        chunk_sums_par(alpbetkernel, &data, ser->N, ny, M, 4, sums);
+    else
+        chunk_sums_par(alpbetWkernel, &data, ser->Npad, ny, M, 4, sums);
+
+    double ss, D;
+    for (size_t i = 0; i < M; ++i) {
+        ss = ser->wsum - sums[4*i+2];
+        D = ss*sums[4*i+2] - sums[4*i+3]*sums[4*i+3];
+        alpha[i] = (sums[4*i] * sums[4*i+2] - sums[4*i+1] * sums[4*i+3])/D;
+        beta[i]  = (sums[4*i+1] * ss - sums[4*i] * sums[4*i+3])/D;
+    }
+    free(sums);
+}
+
+
+// Calculate alpha and beta coefficients for a single frequency
+//  --> With the time series split among the threads if worthwhile
+void alpbetone(struct series *ser, double ny, double *alpha, double *beta)
+{
+    if ( chunk_usetime(ser->N, 1) )
+        alpbetchunk(ser, &ny, 1, alpha, beta);
+    else if ( ser->useweight == 0 )
+        alpbet(ser, ny, alpha, beta);
+    else
+        alpbetW(ser, ny, alpha, beta);
+}
+
+
+// Find the frequency of maximum power (helper for fouriermax), with the time
+// series split among the threads
+void maxchunk(struct series *ser, double freq[], size_t M, double *pmax,\
+              double *nymax)
+{
+    double* ny = malloc(M * sizeof(double));
+    double* alpha = malloc(M * sizeof(double));
+    double* beta = malloc(M * sizeof(double));
+    for (size_t i = 0; i < M; ++i) {
+        ny[i] = freq[i] * PI2micro;
+    }
+    alpbetchunk(ser, ny, M, alpha, beta);
+
+    // First frequency with the highest power
+    double p;
+    for (size_t i = 0; i < M; ++i) {
+        p = alpha[i]*alpha[i] + beta[i]*beta[i];
+        if ( p > *pmax ) {
+            *pmax = p;
+            *nymax = ny[i];
+        }
+    }
+
+    free(ny);
+    free(alpha);
+    free(beta);
+}
+
+
+// Kernel: Terms lo ... hi-1 of the sums (s, c, cc, sc)
+void alpbetkernel(size_t lo, size_t hi, double ny, void *data, double sums[])
+{
+    // Auxiliary
+    struct sumdata* d = data;
+    double sn, cn;
     
     // Sums
     double s = 0;
     double c = 0;
     double cc = 0;
     double sc = 0;
-    double ss;
 
     // Loop over the time series
-    for (size_t i = 0; i < N; ++i) {
+    for (size_t i = lo; i < hi; ++i) {
         // Pre-calculate sin, cos of point
-        sn = sin(ny * time[i]);
-        cn = cos(ny * time[i]);
+        sn = sin(ny * d->time[i]);
+        cn = cos(ny * d->time[i]);
 
         // Calculate sin, cos terms
-        s += weight[i] * flux[i] * sn;
-        c += weight[i] * flux[i] * cn;
+        s += d->flux[i] * sn;
+        c += d->flux[i] * cn;
 
         // Calculate squared and cross terms
-        cc += weight[i] * cn * cn;
-        sc += weight[i] * sn * cn;
+        cc += cn * cn;
+        sc += sn * cn;
     }
 
-    // Calculate ss from cc
-     ss = wsum - cc;
+    sums[0] = s;
+    sums[1] = c;
+    sums[2] = cc;
+    sums[3] = sc;
+}
 
-    // Calculate coefficients
-    D = ss*cc - sc*sc;
-    *alpha = (s * cc - c * sc)/D;
-    *beta  = (c * ss - s * sc)/D;
+
+// Kernel: Terms lo ... hi-1 of the sums (s, c, cc, sc) -- USING WEIGHTS
+void alpbetWkernel(size_t lo, size_t hi, double ny, void *data, double sums[])
+{
+    // Auxiliary
+    struct sumdata* d = data;
+    double sn, cn;
+    
+    // Sums
+    double s = 0;
+    double c = 0;
+    double cc = 0;
+    double sc = 0;
+
+    // Loop over the time series
+    for (size_t i = lo; i < hi; ++i) {
+        // Pre-calculate sin, cos of point
+        sn = sin(ny * d->time[i]);
+        cn = cos(ny * d->time[i]);
+
+        // Calculate sin, cos terms (weight * data from the series)
+        s += d->wflux[i] * sn;
+        c += d->wflux[i] * cn;
+
+        // Calculate squared and cross terms
+        cc += d->weight[i] * cn * cn;
+        sc += d->weight[i] * sn * cn;
+    }
+
+    sums[0] = s;
+    sums[1] = c;
+    sums[2] = cc;
+    sums[3] = sc;
 }
 
 
@@ -184,11 +744,38 @@ void alpbetW(double time[], double flux[], double weight[], size_t N,\
  *  - `alpmax`   : OUTPUT -- Alpha of that frequency
  *  - `betmax`   : OUTPUT -- Beta of that frequency
  *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)  
+ *
+ * Note: With the single-precision engine (see fourier_setengine), the search
+ *       over the sampling frequencies uses single-precision sin/cos. The
+ *       refinement of the peak always uses double precision. With the FFT-
+ *       or zoom-engine, the search uses the spectrum from the Fourier sums
+ *       (if the sampling allows it). With few frequencies compared to the
+ *       number of threads, the time series is split among the threads (also
+ *       for the refinement of the peak).
  */
 void fouriermax(double time[], double flux[], double weight[], double freq[],\
                 size_t N, size_t M, double *fmax, double *alpmax,\
                 double *betmax, int useweight)
 {
+    struct series ser;
+    series_wrap(&ser, time, flux, weight, N, useweight);
+    fouriermax_series(&ser, freq, M, fmax, alpmax, betmax);
+    series_free(&ser);
+}
+
+
+/* Find the highest peak of the fourier transform of a prepared time series
+ *  --> As fouriermax(), see fourier_series
+ */
+void fouriermax_series(struct series *ser, double freq[], size_t M,\
+                       double *fmax, double *alpmax, double *betmax)
+{
+    // The series
+    double* flux = ser->flux;
+    double* weight = ser->weight;
+    size_t N = ser->N;
+    int useweight = ser->useweight;
+
     // Local variables
     double alpha = 0;
     double beta = 0;
@@ -208,51 +795,76 @@ void fouriermax(double time[], double flux[], double weight[], double freq[],\
     double df = PI2micro * (freq[1] - freq[0]);
     double lim1, lim2;
 
+    // Centred times for the single-precision search (power is unaffected)
+    double* tc = NULL;
+    if ( engine == 4 ) tc = series_ctime(ser);
+
+    // Search using the FFT- or zoom-engine (if the sampling allows it)
+    int searched = 0;
+    if ( engine == 2 || engine == 3 )
+        searched = maxspectrum(ser, freq, M, &nymax);
+
     // Call functions with or without weights
     if ( useweight == 0 ) {
         // Function for minimisation (nested for variable access)
         double powopt(double optny)
         {
             double optalpha, optbeta, optpower;
-            alpbet(time, flux, N, optny, &optalpha, &optbeta);
+            alpbetone(ser, optny, &optalpha, &optbeta);
             optpower = optalpha*optalpha + optbeta*optbeta;
             return -optpower;
         }
         
-        // Make parallel loop over all test frequencies
-        #pragma omp parallel default(shared) private(alpha, beta, ny, p, pmaxlocal, nymaxlocal)
-        {
-            // Reset varibles
-            pmaxlocal = 0;
-            nymaxlocal = 0;
-
-            // Do the loop (nowait -> each threads can move on to comparison)
-            #pragma omp for schedule(static) nowait
-            for (i = 0; i < M; ++i) {
-                // Current frequency
-                ny = freq[i] * PI2micro;
-
-                // Calculate alpha, beta and power
-                alpbet(time, flux, N, ny, &alpha, &beta);
-                p = alpha*alpha + beta*beta;
-
-                // Compare to current maximum power
-                if ( p > pmaxlocal ) {
-                    pmaxlocal = p;
-                    nymaxlocal = ny;
+        // FFT- or zoom-engine: Search the spectrum from the Fourier sums
+        if ( searched != 0 ) {
+            // Peak found (refined below)
+        }
+        // Few frequencies: Split the time series among the threads instead
+        else if ( tc == NULL && chunk_usetime(N, M) ) {
+            maxchunk(ser, freq, M, &pmax, &nymax);
+        }
+        else {
+            // Make parallel loop over all test frequencies
+            #pragma omp parallel default(shared) private(alpha, beta, ny, p, pmaxlocal, nymaxlocal)
+            {
+                // Reset varibles
+                pmaxlocal = 0;
+                nymaxlocal = 0;
+
+                // Copy of the series on the node of this thread
+                struct series* loc = series_local(ser);
+
+                // Do the loop (nowait -> each threads can move on to comparison)
+                #pragma omp for schedule(static) nowait
+                for (i = 0; i < M; ++i) {
+                    // Current frequency
+                    ny = freq[i] * PI2micro;
+
+                    // Calculate alpha, beta and power
+                    if ( tc != NULL )
+                        alpbetF(tc, flux, weight, N, ny, N, 0, &alpha, &beta);
+                    else
+                        alpbet(loc, ny, &alpha, &beta);
+                    p = alpha*alpha + beta*beta;
+
+                    // Compare to current maximum power
+                    if ( p > pmaxlocal ) {
+                        pmaxlocal = p;
+                        nymaxlocal = ny;
+                    }
                 }
-            }
 
-            // Make sure we use the maximum from all the threads
-            // NOTE: Double check, since the critical region is slow and should
-            //       only be entered when necessary (and value can be changed
-            //       by several threads, see: goo.gl/lwnzTn)!
-            if ( pmaxlocal > pmax ) {
-                #pragma omp critical
-                {
-                    if ( pmaxlocal > pmax ) {
-                        pmax = pmaxlocal;
-                        nymax = nymaxlocal;
+                // Make sure we use the maximum from all the threads
+                // NOTE: Double check, since the critical region is slow and should
+                //       only be entered when necessary (and value can be changed
+                //       by several threads, see: goo.gl/lwnzTn)!
+                if ( pmaxlocal > pmax ) {
+                    #pragma omp critical
+                    {
+                        if ( pmaxlocal > pmax ) {
+                            pmax = pmaxlocal;
+                            nymax = nymaxlocal;
+                        }
                     }
                 }
             }
@@ -262,62 +874,79 @@ void fouriermax(double time[], double flux[], double weight[], double freq[],\
         //  --> Ensure not to go beyond limits
         if ( nymax-df >  PI2micro * freq[0] ) lim1 = nymax-df;
         else lim1 = PI2micro * freq[0];
-        if ( nymax+df <  PI2micro * freq[M] ) lim2 = nymax+df;
+        if ( nymax+df <  PI2micro * freq[M-1] ) lim2 = nymax+df;
         else lim2 = PI2micro * freq[M-1];
 
         pmax = - fmin_golden(powopt, lim1, lim2, EPS, &nymax);
 
         // Store the optimised values
-        alpbet(time, flux, N, nymax, alpmax, betmax);
+        alpbetone(ser, nymax, alpmax, betmax);
         *fmax = nymax/PI2micro;
     }
     else {
         // Sum of all weights
-        double sumweights = arr_sum(weight, N);
+        double sumweights = ser->wsum;
 
         // Function for minimisation (nested for variable access)
         double powopt(double optny)
         {
             double optalpha, optbeta, optpower;
-            alpbetW(time, flux, weight, N, optny, sumweights, &optalpha, &optbeta);
+            alpbetone(ser, optny, &optalpha, &optbeta);
             optpower = optalpha*optalpha + optbeta*optbeta;
             return -optpower;
         }
 
-        // Make parallel loop over all test frequencies
-        #pragma omp parallel default(shared) private(alpha, beta, ny, p, pmaxlocal, nymaxlocal)
-        {
-            // Reset varibles
-            pmaxlocal = 0;
-            nymaxlocal = 0;
-
-            // Do the loop (nowait -> each threads can move on to comparison)
-            #pragma omp for schedule(static) nowait
-            for (i = 0; i < M; ++i) {
-                // Current frequency
-                ny = freq[i] * PI2micro;
-
-                // Calculate alpha, beta and power
-                alpbetW(time, flux, weight, N, ny, sumweights, &alpha, &beta);
-                p = alpha*alpha + beta*beta;
-
-                // Compare to current maximum power
-                if ( p > pmaxlocal ) {
-                    pmaxlocal = p;
-                    nymaxlocal = ny;
+        // FFT- or zoom-engine: Search the spectrum from the Fourier sums
+        if ( searched != 0 ) {
+            // Peak found (refined below)
+        }
+        // Few frequencies: Split the time series among the threads instead
+        else if ( tc == NULL && chunk_usetime(N, M) ) {
+            maxchunk(ser, freq, M, &pmax, &nymax);
+        }
+        else {
+            // Make parallel loop over all test frequencies
+            #pragma omp parallel default(shared) private(alpha, beta, ny, p, pmaxlocal, nymaxlocal)
+            {
+                // Reset varibles
+                pmaxlocal = 0;
+                nymaxlocal = 0;
+
+                // Copy of the series on the node of this thread
+                struct series* loc = series_local(ser);
+
+                // Do the loop (nowait -> each threads can move on to comparison)
+                #pragma omp for schedule(static) nowait
+                for (i = 0; i < M; ++i) {
+                    // Current frequency
+                    ny = freq[i] * PI2micro;
+
+                    // Calculate alpha, beta and power
+                    if ( tc != NULL )
+                        alpbetF(tc, flux, weight, N, ny, sumweights, 1, &alpha,\
+                                &beta);
+                    else
+                        alpbetW(loc, ny, &alpha, &beta);
+                    p = alpha*alpha + beta*beta;
+
+                    // Compare to current maximum power
+                    if ( p > pmaxlocal ) {
+                        pmaxlocal = p;
+                        nymaxlocal = ny;
+                    }
                 }
-            }
 
-            // Make sure we use the maximum from all the threads
-            // NOTE: Double check, since the critical region is slow and should
-            //       only be entered when necessary (and value can be changed
-            //       by several threads, see: goo.gl/lwnzTn)!
-            if ( pmaxlocal > pmax ) {
-                #pragma omp critical
-                {
-                    if ( pmaxlocal > pmax ) {
-                        pmax = pmaxlocal;
-                        nymax = nymaxlocal;
+                // Make sure we use the maximum from all the threads
+                // NOTE: Double check, since the critical region is slow and should
+                //       only be entered when necessary (and value can be changed
+                //       by several threads, see: goo.gl/lwnzTn)!
+                if ( pmaxlocal > pmax ) {
+                    #pragma omp critical
+                    {
+                        if ( pmaxlocal > pmax ) {
+                            pmax = pmaxlocal;
+                            nymax = nymaxlocal;
+                        }
                     }
                 }
             }
@@ -327,14 +956,43 @@ void fouriermax(double time[], double flux[], double weight[], double freq[],\
         //  --> Ensure not to go beyond limits
         if ( nymax-df >  PI2micro * freq[0] ) lim1 = nymax-df;
         else lim1 = PI2micro * freq[0];
-        if ( nymax+df <  PI2micro * freq[M] ) lim2 = nymax+df;
+        if ( nymax+df <  PI2micro * freq[M-1] ) lim2 = nymax+df;
         else lim2 = PI2micro * freq[M-1];
 
         pmax = - fmin_golden(powopt, lim1, lim2, EPS, &nymax);
         
         // Store the optimised values
-        alpbetW(time, flux, weight, N, nymax, sumweights, alpmax, betmax);
+        alpbetone(ser, nymax, alpmax, betmax);
         *fmax = nymax/PI2micro;
     }
-    // Done!
+}
+
+
+// Frequency of the highest peak of the spectrum from the FFT- or zoom-engine
+//  --> Returns 0 (and does nothing) if neither engine can be used
+int maxspectrum(struct series *ser, double freq[], size_t M, double *nymax)
+{
+    double* power = malloc(M * sizeof(double));
+    double* alpha = malloc(M * sizeof(double));
+    double* beta = malloc(M * sizeof(double));
+    int done = 0;
+
+    if ( engine == 3 )
+        done = fourierzoom(ser, freq, M, power, alpha, beta);
+    if ( done == 0 )
+        done = fourierfft(ser, freq, M, power, alpha, beta);
+
+    // First maximum (as the direct search)
+    if ( done != 0 ) {
+        size_t imax = 0;
+        for (size_t i = 1; i < M; ++i) {
+            if ( power[i] > power[imax] ) imax = i;
+        }
+        *nymax = freq[imax] * PI2micro;
+    }
+
+    free(power);
+    free(alpha);
+    free(beta);
+    return done;
 }
@@ -1,3 +1,15 @@
+void fourier_setengine(int choice);
+
+int fourier_getengine(void);
+
+double fourier_settrig(int tier);
+
+int fourier_gettrig(void);
+
+size_t fourier_fftgrid(double time[], size_t N, size_t M);
+
+size_t fourier_zoombins(double time[], size_t N, double df, size_t M);
+
 void fourier(double time[], double flux[], double weight[], double freq[],\
              size_t N, size_t M, double power[], double alpha[], double beta[],\
              int useweight);
@@ -5,3 +17,11 @@ void fourier(double time[], double flux[], double weight[], double freq[],\
 void fouriermax(double time[], double flux[], double weight[], double freq[],\
                 size_t N, size_t M, double *fmax, double *alpmax,\
                 double *betmax, int useweight);
+
+struct series;
+
+void fourier_series(struct series *ser, double freq[], size_t M,\
+                    double power[], double alpha[], double beta[]);
+
+void fouriermax_series(struct series *ser, double freq[], size_t M,\
+                       double *fmax, double *alpmax, double *betmax);
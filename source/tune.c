@@ -0,0 +1,333 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Automatic choice of the engine for the power spectrum (-engine auto|tune)
+ *
+ * The run time of each engine is estimated from a cost model in the length
+ * of the series, the number of frequencies, the regularity of the cadence,
+ * the width of the band and the number of threads. The coefficients of the
+ * model (seconds per unit of work on one thread) are read from a tuning
+ * file if it exists: given by the shell variable "TSA_TUNING", or
+ * "tsa/tuning.txt" in the user cache ($XDG_CACHE_HOME, or ~/.cache).
+ * Otherwise built-in coefficients are used, so the choice only depends on
+ * the input. Only with -engine tune are the coefficients measured by a
+ * micro-benchmark (with the exact sines and cosines) and the tuning file
+ * written (e.g. once on a new machine).
+ *
+ * Only engines which give the direct sums to rounding error are considered
+ * (direct, fft, zoom), and only if the sampling allows them -- otherwise the
+ * direct sums are used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#include "tsfourier.h"
+#include "fft.h"
+#include "zoom.h"
+#include "chunk.h"
+
+// Name of the environment variable and the tuning file in the user cache
+#define TUNEVAR "TSA_TUNING"
+#define TUNEDIR "tsa"
+#define TUNEFILE "tuning.txt"
+
+// Coefficients without a tuning file (measured on one x86-64 core)
+#define COSTDIRECT 2.3e-8
+#define COSTFFT 5.7e-9
+#define COSTZOOM 3.8e-9
+
+#define PI2 6.28318530717958647692528676655900576839433879875
+
+// Coefficients of the cost model (seconds per unit on one thread)
+struct costs {
+    double direct;  // One point at one frequency
+    double fft;     // One element (times log2 of the length) of a transform
+    double zoom;    // One moment of one point (mixing down)
+};
+
+int tunepath(char path[], size_t len, int create);
+
+int tune_read(char *fname, struct costs *c);
+
+void tune_write(char *fname, struct costs *c);
+
+void tune_bench(struct costs *c);
+
+double cztunits(size_t L, size_t M, int threads);
+
+double benchtime(double time[], double flux[], size_t N, double low,\
+                 double rate, size_t M, int engine);
+
+
+/* Choose the engine for a spectrum of M frequencies (from `low` in steps of
+ * `rate`, in microHz)
+ *
+ * Arguments:
+ *  - `time` : Array of times. In seconds!
+ *  - `N`    : Length of the time series
+ *  - `low`  : First frequency
+ *  - `rate` : Spacing of the frequencies
+ *  - `M`    : Number of frequencies
+ *  - `measure`: Measure the coefficients and write the tuning file (-engine
+ *               tune) instead of reading them
+ *  - `quiet`: Do not write the choice and its reason to the console
+ *
+ * Returns the engine (see fourier_setengine): 1 = direct, 2 = fft, 3 = zoom.
+ */
+int tune_engine(double time[], size_t N, double low, double rate, size_t M,\
+                int measure, int quiet)
+{
+    char fname[600];
+    struct costs c = {COSTDIRECT, COSTFFT, COSTZOOM};
+    int threads = omp_get_max_threads();
+
+    // Measure the coefficients and store them, or read the tuning file (if
+    // there is one)
+    if ( measure != 0 ) {
+        if ( quiet == 0 )
+            printf(" -- INFO: Measuring the cost of the engines\n");
+        tune_bench(&c);
+        if ( tunepath(fname, sizeof(fname), 1) != 0 ) {
+            tune_write(fname, &c);
+            if ( quiet == 0 )
+                printf(" -- INFO: Cost model stored in \"%s\"\n", fname);
+        }
+    }
+    else if ( tunepath(fname, sizeof(fname), 0) != 0 ) {
+        struct costs stored;
+        if ( tune_read(fname, &stored) != 0 ) {
+            c = stored;
+            if ( quiet == 0 )
+                printf(" -- INFO: Cost model from \"%s\"\n", fname);
+        }
+    }
+
+    // Direct sums: Frequencies (or the time series) split among the threads
+    double par = ( chunk_usetime(N, M) || M > (size_t) threads ) ? threads : M;
+    double tdirect = c.direct * N * M / par;
+
+    // FFT: Two chirp-z transforms of the grid (sums at ny and 2ny)
+    double tfft = -1;
+    size_t L = fourier_fftgrid(time, N, M);
+    if ( L > 0 ) tfft = c.fft * 2 * cztunits(L, M, threads);
+
+    // Zoom: Mixing down (serial) and the transforms of each moment
+    double tzoom = -1;
+    size_t bins = fourier_zoombins(time, N, rate, M);
+    if ( bins > 0 ) {
+        double terms = zoom_terms();
+        tzoom = c.zoom * 2 * N * terms +\
+                c.fft * 2 * terms * cztunits(bins, M, threads);
+    }
+
+    // Cheapest engine
+    int choice = 1;
+    double best = tdirect;
+    if ( tfft >= 0 && tfft < best ) {
+        choice = 2;
+        best = tfft;
+    }
+    if ( tzoom >= 0 && tzoom < best ) {
+        choice = 3;
+        best = tzoom;
+    }
+
+    // Why?
+    if ( quiet == 0 ) {
+        char fftwhy[40], zoomwhy[40];
+        if ( tfft >= 0 ) snprintf(fftwhy, sizeof(fftwhy), "%.3lg s", tfft);
+        else snprintf(fftwhy, sizeof(fftwhy), "not on a cadence grid");
+        if ( tzoom >= 0 ) snprintf(zoomwhy, sizeof(zoomwhy), "%.3lg s", tzoom);
+        else snprintf(zoomwhy, sizeof(zoomwhy), "band too wide");
+        printf(" -- INFO: Engine (auto) = %s. Estimates with %i threads:"\
+               " direct %.3lg s, fft %s, zoom %s\n",\
+               ( choice == 1 ) ? "direct" : ( choice == 2 ) ? "fft" : "zoom",\
+               threads, tdirect, fftwhy, zoomwhy);
+    }
+
+    return choice;
+}
+
+
+// Work of a chirp-z transform (series of length L, M frequencies): the
+// transform of the filter, and two transforms per block of frequencies
+double cztunits(size_t L, size_t M, int threads)
+{
+    size_t Nblock;
+    double P = czt_size(L, M, &Nblock);
+    double par = ( Nblock < (size_t) threads ) ? Nblock : threads;
+    return P * log2(P) * (1 + 2 * Nblock / par);
+}
+
+
+// Name of the tuning file (the directory in the user cache is created if
+// `create` != 0). Returns 0 if there is no place for it
+int tunepath(char path[], size_t len, int create)
+{
+    char* env = getenv(TUNEVAR);
+    if ( env != NULL && env[0] != '\0' ) {
+        snprintf(path, len, "%s", env);
+        return 1;
+    }
+
+    char cache[500];
+    env = getenv("XDG_CACHE_HOME");
+    if ( env != NULL && env[0] == '/' )
+        snprintf(cache, sizeof(cache), "%s", env);
+    else if ( (env = getenv("HOME")) != NULL && env[0] == '/' )
+        snprintf(cache, sizeof(cache), "%s/.cache", env);
+    else
+        return 0;
+
+    if ( create != 0 ) {
+        mkdir(cache, 0700);
+        snprintf(path, len, "%s/%s", cache, TUNEDIR);
+        mkdir(path, 0700);
+    }
+    snprintf(path, len, "%s/%s/%s", cache, TUNEDIR, TUNEFILE);
+    return 1;
+}
+
+
+// Read the coefficients. Returns 0 if the file is missing or incomplete
+int tune_read(char *fname, struct costs *c)
+{
+    char name[40];
+    double value;
+    int found = 0;
+
+    FILE* infile = fopen(fname, "r");
+    if ( infile == NULL ) return 0;
+
+    char line[200];
+    while ( fgets(line, sizeof(line), infile) != NULL ) {
+        if ( line[0] == '#' ) continue;
+        if ( sscanf(line, "%39s %lf", name, &value) != 2 || value <= 0 )
+            continue;
+        if ( strcmp(name, "direct") == 0 ) {
+            c->direct = value;
+            found |= 1;
+        }
+        else if ( strcmp(name, "fft") == 0 ) {
+            c->fft = value;
+            found |= 2;
+        }
+        else if ( strcmp(name, "zoom") == 0 ) {
+            c->zoom = value;
+            found |= 4;
+        }
+    }
+    fclose(infile);
+
+    return ( found == 7 );
+}
+
+
+// Write the coefficients (via a temporary file, so concurrent runs never
+// read a partial file)
+void tune_write(char *fname, struct costs *c)
+{
+    char tmpname[700];
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp%li", fname, (long) getpid());
+
+    FILE* outfile = fopen(tmpname, "w");
+    if ( outfile == NULL ) {
+        fprintf(stderr, "Warning: Cannot write tuning file \"%s\"\n", fname);
+        return;
+    }
+    fprintf(outfile, "# Cost model of the spectrum engines (tune.c)\n");
+    fprintf(outfile, "# Seconds per unit of work on one thread\n");
+    fprintf(outfile, "direct %.6le\n", c->direct);
+    fprintf(outfile, "fft %.6le\n", c->fft);
+    fprintf(outfile, "zoom %.6le\n", c->zoom);
+    if ( fclose(outfile) != 0 || rename(tmpname, fname) != 0 )
+        remove(tmpname);
+}
+
+
+// Measure the coefficients (on one thread, the fastest of three runs, with
+// the exact sines and cosines)
+void tune_bench(struct costs *c)
+{
+    int threads = omp_get_max_threads();
+    int engine = fourier_getengine();
+    int trig = fourier_gettrig();
+    omp_set_num_threads(1);
+    fourier_settrig(0);
+
+    // Synthetic series: regular cadence and jittered
+    size_t N = 65536;
+    double* treg = malloc(N * sizeof(double));
+    double* tjit = malloc(N * sizeof(double));
+    double* flux = malloc(N * sizeof(double));
+    for (size_t i = 0; i < N; ++i) {
+        treg[i] = 60.0 * i;
+        tjit[i] = 60.0 * i + 20.0 * sin(1.7 * i);
+        flux[i] = sin(PI2 * 1e-3 * treg[i]) + 0.3 * cos(0.9 * i);
+    }
+
+    // Direct sums
+    size_t Nd = 4096;
+    size_t Md = 256;
+    c->direct = benchtime(tjit, flux, Nd, 100, 0.1, Md, 1) / ((double) Nd*Md);
+
+    // FFT on the regular grid
+    size_t Nf = 16384;
+    size_t Mf = 16384;
+    c->fft = benchtime(treg, flux, Nf, 100, 0.5, Mf, 2) /\
+             (2 * cztunits(Nf, Mf, 1));
+
+    // Zoom on a narrow band (the mixing dominates)
+    size_t Mz = 64;
+    double rate = 0.01;
+    double tz = benchtime(tjit, flux, N, 3000, rate, Mz, 3);
+    double terms = zoom_terms();
+    double ttrans = c->fft * 2 * terms *\
+                    cztunits(fourier_zoombins(tjit, N, rate, Mz), Mz, 1);
+    if ( tz - ttrans > 0.1 * tz ) tz -= ttrans;
+    else tz *= 0.1;
+    c->zoom = tz / (2 * N * terms);
+
+    // Restore the settings
+    free(treg);
+    free(tjit);
+    free(flux);
+    fourier_setengine(engine);
+    fourier_settrig(trig);
+    omp_set_num_threads(threads);
+}
+
+
+// Time of a spectrum with the given engine (the fastest of three runs)
+double benchtime(double time[], double flux[], size_t N, double low,\
+                 double rate, size_t M, int engine)
+{
+    double* freq = malloc(M * sizeof(double));
+    double* power = malloc(M * sizeof(double));
+    double* alpha = malloc(M * sizeof(double));
+    double* beta = malloc(M * sizeof(double));
+    for (size_t j = 0; j < M; ++j) {
+        freq[j] = low + j * rate;
+    }
+
+    double best = -1;
+    fourier_setengine(engine);
+    for (int r = 0; r < 3; ++r) {
+        double start = omp_get_wtime();
+        fourier(time, flux, NULL, freq, N, M, power, alpha, beta, 0);
+        double elapsed = omp_get_wtime() - start;
+        if ( best < 0 || elapsed < best ) best = elapsed;
+    }
+
+    free(freq);
+    free(power);
+    free(alpha);
+    free(beta);
+    return ( best > 0 ) ? best : 1e-9;
+}
@@ -0,0 +1,2 @@
+int tune_engine(double time[], size_t N, double low, double rate, size_t M,\
+                int measure, int quiet);
@@ -0,0 +1,156 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Persistent on-disk cache for spectral windows
+ *
+ * The window function only depends on the times, the weights and the
+ * frequency sampling -- not on the data. Results are stored in the directory
+ * given by the shell variable "TSA_WINCACHE" (no caching if it is not set),
+ * in files named by a hash of the times, weights and sampling parameters.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Name of the environment variable and identifier of the file format
+#define CACHEVAR "TSA_WINCACHE"
+#define MAGIC "TSAWIN01"
+
+// FNV-1a (64 bit) constants
+#define FNVOFFSET 14695981039346656037ULL
+#define FNVPRIME 1099511628211ULL
+
+uint64_t wincache_datakey(double time[], double weight[], size_t N,\
+                          int useweight);
+uint64_t hashbytes(uint64_t hash, const void *data, size_t nbytes);
+int cachepath(char path[], size_t len, uint64_t key, char *kind);
+
+
+/* Calculate the cache key of a window
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `weight`   : Array of statistical weights (only used if useweight != 0).
+ *  - `N`        : Length of the time series
+ *  - `param`    : Array of parameters of the sampling (frequencies etc.)
+ *  - `P`        : Length of the parameter array
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ */
+uint64_t wincache_key(double time[], double weight[], size_t N, double param[],\
+                      size_t P, int useweight)
+{
+    uint64_t hash = wincache_datakey(time, weight, N, useweight);
+    return hashbytes(hash, param, P * sizeof(double));
+}
+
+
+/* Hash of the times and weights alone (the first part of the cache key)
+ *  --> The key of a window is the hash continued by its parameters, so a
+ *      prepared series hashes its sampling only once (see series_key)
+ */
+uint64_t wincache_datakey(double time[], double weight[], size_t N,\
+                          int useweight)
+{
+    uint64_t hash = FNVOFFSET;
+    uint64_t n = N;
+    uint64_t w = useweight;
+
+    hash = hashbytes(hash, &n, sizeof(n));
+    hash = hashbytes(hash, &w, sizeof(w));
+    hash = hashbytes(hash, time, N * sizeof(double));
+    if ( useweight != 0 )
+        hash = hashbytes(hash, weight, N * sizeof(double));
+
+    return hash;
+}
+
+
+/* Look up an entry in the cache
+ *  --> Returns 1 and fills `data` (length M) if found, otherwise 0
+ */
+int wincache_load(uint64_t key, char *kind, double data[], size_t M)
+{
+    char path[512];
+    char magic[8];
+    uint64_t filekey, fileM;
+    int found = 0;
+
+    // Caching disabled?
+    if ( cachepath(path, sizeof(path), key, kind) == 0 ) return 0;
+
+    FILE* infile = fopen(path, "rb");
+    if ( infile == NULL ) return 0;
+
+    // Check the header before reading the data
+    if ( fread(magic, 1, 8, infile) == 8 && memcmp(magic, MAGIC, 8) == 0 &&\
+         fread(&filekey, sizeof(filekey), 1, infile) == 1 && filekey == key &&\
+         fread(&fileM, sizeof(fileM), 1, infile) == 1 && fileM == M ) {
+        if ( fread(data, sizeof(double), M, infile) == M ) found = 1;
+    }
+    fclose(infile);
+
+    return found;
+}
+
+
+/* Store an entry in the cache
+ *  --> Written to a temporary file and renamed, so the entry is atomically
+ *      replaced and concurrent runs never see a partial file
+ */
+void wincache_store(uint64_t key, char *kind, double data[], size_t M)
+{
+    char path[512];
+    char tmppath[600];
+    uint64_t fileM = M;
+    int success = 0;
+
+    // Caching disabled?
+    if ( cachepath(path, sizeof(path), key, kind) == 0 ) return;
+    // Unique per process and per call (threads of a server may store the
+    // same entry at the same time)
+    static long counter = 0;
+    long call = __sync_fetch_and_add(&counter, 1);
+    snprintf(tmppath, sizeof(tmppath), "%s.tmp%li.%li", path, (long) getpid(),\
+             call);
+
+    FILE* outfile = fopen(tmppath, "wb");
+    if ( outfile == NULL ) {
+        fprintf(stderr, "Warning: Cannot write to window cache \"%s\"\n",\
+                tmppath);
+        return;
+    }
+    if ( fwrite(MAGIC, 1, 8, outfile) == 8 &&\
+         fwrite(&key, sizeof(key), 1, outfile) == 1 &&\
+         fwrite(&fileM, sizeof(fileM), 1, outfile) == 1 &&\
+         fwrite(data, sizeof(double), M, outfile) == M )
+        success = 1;
+    if ( fclose(outfile) != 0 ) success = 0;
+
+    // Move into place (or clean up)
+    if ( success == 0 || rename(tmppath, path) != 0 ) remove(tmppath);
+}
+
+
+// Hash a block of memory (FNV-1a)
+uint64_t hashbytes(uint64_t hash, const void *data, size_t nbytes)
+{
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < nbytes; ++i) {
+        hash ^= bytes[i];
+        hash *= FNVPRIME;
+    }
+    return hash;
+}
+
+
+// Make the file name of an entry. Returns 0 if caching is disabled
+int cachepath(char path[], size_t len, uint64_t key, char *kind)
+{
+    char* dir = getenv(CACHEVAR);
+    if ( dir == NULL || dir[0] == '\0' ) return 0;
+
+    snprintf(path, len, "%s/%016llx.%s", dir, (unsigned long long) key, kind);
+    return 1;
+}
@@ -0,0 +1,11 @@
+uint64_t wincache_key(double time[], double weight[], size_t N, double param[],\
+                      size_t P, int useweight);
+
+uint64_t wincache_datakey(double time[], double weight[], size_t N,\
+                          int useweight);
+
+int wincache_load(uint64_t key, char *kind, double data[], size_t M);
+
+void wincache_store(uint64_t key, char *kind, double data[], size_t M);
+
+uint64_t hashbytes(uint64_t hash, const void *data, size_t nbytes);
@@ -7,12 +7,46 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
+#include <complex.h>
 #include <omp.h>
 #include "arrlib.h"
+#include "wincache.h"
+#include "fft.h"
+#include "tsfourier.h"
+#include "chunk.h"
+#include "series.h"
 
+#define PI2 6.28318530717958647692528676655900576839433879875
 #define PI2micro 6.28318530717958647692528676655900576839433879875e-6
 
+// Fast (FFT) window: Max. number of grid points per data point (sparse
+// grids; the grid itself is determined by series_grid, as for the FFT-engine
+// in tsfourier.c, so the window equals the direct sums)
+#define WINGRIDFILL 8
+
+// Number of parameters in front of the keys of the cache (see winparam)
+#define WINKEYS 3
+
+// Arrays used by the kernels of the direct sums
+struct windata {
+    double* time;
+    double* weight;
+    double* datasin;
+    double* datacos;
+};
+
+void windowfunction_series(struct series *s, double freq[], size_t M,\
+                           double f0, double window[]);
+
+void windowmulti_series(struct series *s, double delta[], size_t M,\
+                        double f0[], size_t K, double window[]);
+
+double windowsum_series(struct series *s, double f0, double low, double high,\
+                        double rate, int quiet);
+
 void windowalpbet(double time[], double datasin[], double datacos[], size_t N,\
                   double ny, double *alphasin, double *betasin,
                   double *alphacos, double *betacos);
@@ -22,6 +56,30 @@ void windowalpbetW(double time[], double weight[], double datasin[],\
                    double *alphasin, double *betasin, double *alphacos,\
                    double *betacos);
 
+void wincoeffs(double sums[], double wsum, double *alphasin, double *betasin,\
+               double *alphacos, double *betacos);
+
+void windowkernel(size_t lo, size_t hi, double ny, void *data, double sums[]);
+
+void windowWkernel(size_t lo, size_t hi, double ny, void *data, double sums[]);
+
+void windowalpbetF(double tc[], double weight[], double datasin[],\
+                   double datacos[], size_t N, double ny, double wsum,\
+                   int useweight, double *alphasin, double *betasin,\
+                   double *alphacos, double *betacos);
+
+int windowfft(struct series *s, double freq[], size_t M, double f0,\
+              double window[]);
+
+size_t windowgrid(struct series *s, size_t M);
+
+void winparam(double param[], double f0);
+
+uint64_t winkey(struct series *s, double param[], size_t P);
+
+void windowshared(struct series *s, double delta[], size_t M, double f0[],\
+                  size_t K, double window[]);
+
 
 /* Calculate the window function of a time series
  *
@@ -33,15 +91,60 @@ void windowalpbetW(double time[], double weight[], double datasin[],\
  *  - `M`        : Length of the sampling vector
  *  - `window`   : OUTPUT -- Array with power of the window
  *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ *
+ * Note: The result is looked up in (and stored to) the window cache. If the
+ *       times lie on a regular cadence grid (with gaps) and the frequencies
+ *       are equidistant, the fast FFT-based calculation is used -- unless
+ *       the direct or single-precision engine is selected for fourier().
  */
 void windowfunction(double time[], double freq[], double weight[], size_t N,\
                     size_t M, double f0, double window[], int useweight)
 {
+    struct series ser;
+    series_wrap(&ser, time, NULL, weight, N, useweight);
+    windowfunction_series(&ser, freq, M, f0, window);
+    series_free(&ser);
+}
+
+
+/* Calculate the window function of a prepared time series (see series.c)
+ *  --> As windowfunction(), but the sum of the weights, the cadence grid,
+ *      the centred times and the hash of the sampling (for the cache) are
+ *      taken from the series. The data of the series is not used
+ */
+void windowfunction_series(struct series *s, double freq[], size_t M,\
+                           double f0, double window[])
+{
+    double* time = s->time;
+    double* weight = s->weight;
+    size_t N = s->N;
+    int useweight = s->useweight;
+
+    // Look for the window in the cache (keyed by f0, the engine and all
+    // frequencies)
+    double* param = malloc((M+WINKEYS) * sizeof(double));
+    winparam(param, f0);
+    memcpy(&param[WINKEYS], freq, M * sizeof(double));
+    uint64_t key = winkey(s, param, M+WINKEYS);
+    free(param);
+    if ( wincache_load(key, "win", window, M) != 0 ) return;
+
+    // Use the FFT-based calculation if possible
+    int engine = fourier_getengine();
+    if ( engine != 1 && engine != 4 &&\
+         windowfft(s, freq, M, f0, window) != 0 ) {
+        wincache_store(key, "win", window, M);
+        return;
+    }
+
     // Sample the time series using cos and sin at frequency f0
-    double* datsin = malloc(N * sizeof(double));
-    double* datcos = malloc(N * sizeof(double));
+    //  --> Also the padding of the series, so the weighted sums may run over
+    //      the padded length (zero weight)
+    size_t Nw = ( useweight != 0 ) ? s->Npad : N;
+    double* datsin = malloc(Nw * sizeof(double));
+    double* datcos = malloc(Nw * sizeof(double));
     double omega0 = f0 * PI2micro;
-    for (size_t k = 0; k < N; ++k) {
+    for (size_t k = 0; k < Nw; ++k) {
         datsin[k] = sin(omega0 * time[k]);
         datcos[k] = cos(omega0 * time[k]);
     }
@@ -54,8 +157,55 @@ void windowfunction(double time[], double freq[], double weight[], size_t N,\
     double ny = 0;
     size_t i;
 
-    // Call functions with or without weights
-    if ( useweight == 0 ) {
+    // Call functions with single-precision sin/cos, split the time series among
+    // the threads (few frequencies), or with or without weights
+    if ( engine != 4 && chunk_usetime(N, M) ) {
+        double sumweights = s->wsum;
+        double* nys = malloc(M * sizeof(double));
+        double* sums = malloc(6 * M * sizeof(double));
+        for (i = 0; i < M; ++i) {
+            nys[i] = freq[i] * PI2micro;
+        }
+        struct windata data = {time, weight, datsin, datcos};
+        if ( useweight == 0 )
+            chunk_sums_par(windowkernel, &data, N, nys, M, 6, sums);
+        else
+            chunk_sums_par(windowWkernel, &data, Nw, nys, M, 6, sums);
+
+        for (i = 0; i < M; ++i) {
+            wincoeffs(&sums[6*i], sumweights, &alphasin, &betasin, &alphacos,\
+                      &betacos);
+            window[i] = 0.5 * ( (alphasin*alphasin + betasin*betasin) + \
+                                (alphacos*alphacos + betacos*betacos)    );
+        }
+        free(nys);
+        free(sums);
+    }
+    else if ( engine == 4 ) {
+        // Times centred around the middle (the power is unaffected)
+        double* tc = series_ctime(s);
+        double sumweights = s->wsum;
+
+        // Make parallel loop over all test frequencies
+        #pragma omp parallel default(shared) private(alphasin, betasin, alphacos, betacos, ny)
+        {
+            #pragma omp for schedule(static)
+            for (i = 0; i < M; ++i) {
+                // Current frequency
+                ny = freq[i] * PI2micro;
+
+                // Calculate alpha and beta for cos and sin data
+                windowalpbetF(tc, weight, datsin, datcos, N, ny, sumweights,\
+                              useweight, &alphasin, &betasin, &alphacos,\
+                              &betacos);
+                
+                // Store power
+                window[i] = 0.5 * ( (alphasin*alphasin + betasin*betasin) + \
+                                    (alphacos*alphacos + betacos*betacos)    );
+            }
+        }
+    }
+    else if ( useweight == 0 ) {
         // Make parallel loop over all test frequencies
         #pragma omp parallel default(shared) private(alphasin, betasin, alphacos, betacos, ny)
         {
@@ -76,7 +226,7 @@ void windowfunction(double time[], double freq[], double weight[], size_t N,\
     }
     else {
         // Sum of all weights
-        double sumweights = arr_sum(weight, N);
+        double sumweights = s->wsum;
         
         // Make parallel loop over all test frequencies
         #pragma omp parallel default(shared) private(alphasin, betasin, alphacos, betacos, ny)
@@ -87,7 +237,7 @@ void windowfunction(double time[], double freq[], double weight[], size_t N,\
                 ny = freq[i] * PI2micro;
 
                 // Calculate alpha and beta for cos and sin data
-                windowalpbetW(time, weight, datsin, datcos, N, ny, sumweights, \
+                windowalpbetW(time, weight, datsin, datcos, Nw, ny, sumweights,\
                               &alphasin, &betasin, &alphacos, &betacos);
                 
                 // Store power
@@ -100,6 +250,207 @@ void windowfunction(double time[], double freq[], double weight[], size_t N,\
     // Done
     free(datsin);
     free(datcos);
+    wincache_store(key, "win", window, M);
+}
+
+
+/* Calculate the window functions at several frequencies (in one pass)
+ *
+ * Arguments:
+ *  - `time`     : Array of times. In seconds!
+ *  - `delta`    : Array of offsets from the window frequencies to sample
+ *                 (common to all windows).
+ *  - `weight`   : Array of statistical weights.
+ *  - `N`        : Length of the time series
+ *  - `M`        : Length of the sampling vector
+ *  - `f0`       : Array of window frequencies
+ *  - `K`        : Number of windows
+ *  - `window`   : OUTPUT -- Array (K*M) with the power of the windows. The
+ *                 window at f0[k] sampled at f0[k] + delta[j] is stored in
+ *                 window[k*M + j]
+ *  - `useweight`: Flag to signal whether to use weights or not (0 = no weights)
+ *
+ * Note: Windows for the FFT-based calculation (or the single-precision
+ *       engine, or few frequencies) are calculated one by one using
+ *       windowfunction. Otherwise, all windows not in the cache are
+ *       calculated in a single pass over the time series, sharing each
+ *       sin/cos of the offsets (see windowshared).
+ */
+void windowmulti(double time[], double delta[], double weight[], size_t N,\
+                 size_t M, double f0[], size_t K, double window[],\
+                 int useweight)
+{
+    struct series ser;
+    series_wrap(&ser, time, NULL, weight, N, useweight);
+    windowmulti_series(&ser, delta, M, f0, K, window);
+    series_free(&ser);
+}
+
+
+/* Calculate the window functions at several frequencies of a prepared time
+ * series (see windowmulti and windowfunction_series)
+ */
+void windowmulti_series(struct series *s, double delta[], size_t M,\
+                        double f0[], size_t K, double window[])
+{
+    size_t N = s->N;
+    double* freq = malloc(M * sizeof(double));
+    double* param = malloc((M+WINKEYS) * sizeof(double));
+    uint64_t* keys = malloc(K * sizeof(uint64_t));
+    size_t* todo = malloc(K * sizeof(size_t));
+    size_t T = 0;
+
+    // One by one?
+    int engine = fourier_getengine();
+    int single = ( engine == 4 || chunk_usetime(N, M) ||\
+                   ( engine != 1 && windowgrid(s, M) != 0 ) );
+
+    for (size_t k = 0; k < K; ++k) {
+        for (size_t j = 0; j < M; ++j) {
+            freq[j] = f0[k] + delta[j];
+        }
+        if ( single != 0 ) {
+            windowfunction_series(s, freq, M, f0[k], &window[k*M]);
+            continue;
+        }
+
+        // Look in the cache (as windowfunction)
+        winparam(param, f0[k]);
+        memcpy(&param[WINKEYS], freq, M * sizeof(double));
+        keys[k] = winkey(s, param, M+WINKEYS);
+        if ( wincache_load(keys[k], "win", &window[k*M], M) == 0 )
+            todo[T++] = k;
+    }
+
+    // The rest in one pass
+    if ( T > 0 ) {
+        double* f0todo = malloc(T * sizeof(double));
+        double* wintodo = malloc(T * M * sizeof(double));
+        for (size_t t = 0; t < T; ++t) {
+            f0todo[t] = f0[todo[t]];
+        }
+        windowshared(s, delta, M, f0todo, T, wintodo);
+        for (size_t t = 0; t < T; ++t) {
+            size_t k = todo[t];
+            memcpy(&window[k*M], &wintodo[t*M], M * sizeof(double));
+            wincache_store(keys[k], "win", &window[k*M], M);
+        }
+        free(f0todo);
+        free(wintodo);
+    }
+
+    free(freq);
+    free(param);
+    free(keys);
+    free(todo);
+}
+
+
+// Windows at K frequencies f0 in a single pass over the series
+//  --> The sampling frequency f0 + delta follows from the angle-addition
+//      theorem, using sin/cos of f0 (per point, calculated once) and of the
+//      offset (per point and offset, shared by all windows)
+void windowshared(struct series *s, double delta[], size_t M, double f0[],\
+                  size_t K, double window[])
+{
+    double* time = s->time;
+    double* weight = s->weight;
+    size_t N = s->N;
+    int useweight = s->useweight;
+
+    // Sample the time series using cos and sin at all frequencies f0
+    double* S0 = malloc(N * K * sizeof(double));
+    double* C0 = malloc(N * K * sizeof(double));
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t k = 0; k < K; ++k) {
+            S0[i*K + k] = sin(f0[k] * PI2micro * time[i]);
+            C0[i*K + k] = cos(f0[k] * PI2micro * time[i]);
+        }
+    }
+    double sumweights = s->wsum;
+
+    // Make parallel loop over all offsets
+    #pragma omp parallel default(shared)
+    {
+        // Sums (ssin, csin, scos, ccos, cc, sc) of every window
+        double* sums = malloc(6 * K * sizeof(double));
+        double alphasin, betasin, alphacos, betacos;
+
+        #pragma omp for schedule(static)
+        for (size_t j = 0; j < M; ++j) {
+            double d = delta[j] * PI2micro;
+            for (size_t m = 0; m < 6*K; ++m) {
+                sums[m] = 0;
+            }
+
+            for (size_t i = 0; i < N; ++i) {
+                // sin, cos of the offset (shared by all windows)
+                double sd = sin(d * time[i]);
+                double cd = cos(d * time[i]);
+                double w = (useweight != 0) ? weight[i] : 1.0;
+                double* s0 = &S0[i*K];
+                double* c0 = &C0[i*K];
+
+                for (size_t k = 0; k < K; ++k) {
+                    // sin, cos at the sampling frequency f0 + delta
+                    double sn = s0[k] * cd + c0[k] * sd;
+                    double cn = c0[k] * cd - s0[k] * sd;
+                    double ws = w * s0[k];
+                    double wc = w * c0[k];
+                    double* sk = &sums[6*k];
+                    sk[0] += ws * sn;
+                    sk[1] += ws * cn;
+                    sk[2] += wc * sn;
+                    sk[3] += wc * cn;
+                    sk[4] += w * cn * cn;
+                    sk[5] += w * sn * cn;
+                }
+            }
+
+            for (size_t k = 0; k < K; ++k) {
+                wincoeffs(&sums[6*k], sumweights, &alphasin, &betasin,\
+                          &alphacos, &betacos);
+                window[k*M + j] = 0.5 * ( (alphasin*alphasin +\
+                                           betasin*betasin) +\
+                                          (alphacos*alphacos +\
+                                           betacos*betacos) );
+            }
+        }
+        free(sums);
+    }
+
+    free(S0);
+    free(C0);
+}
+
+
+// Parameters in front of the keys of the cache: f0, the engine and the
+// accuracy of sin/cos (the FFT-based, single-precision and direct windows
+// differ slightly, and must not be returned for each other)
+void winparam(double param[], double f0)
+{
+    param[0] = f0;
+    param[1] = fourier_getengine();
+    param[2] = fourier_gettrig();
+}
+
+
+// Cache key of a window: The hash of the sampling (kept with the series)
+// continued by the parameters (as wincache_key)
+uint64_t winkey(struct series *s, double param[], size_t P)
+{
+    return hashbytes(series_key(s), param, P * sizeof(double));
+}
+
+
+// Is the series on a cadence grid for the FFT-based window? (the length of
+// the grid, 0 if not)
+size_t windowgrid(struct series *s, size_t M)
+{
+    double t0, dt;
+    size_t L = series_grid(s, &t0, &dt);
+    if ( L == 0 || L > WINGRIDFILL * s->N || M < 2 ) return 0;
+    return L;
 }
 
 
@@ -107,9 +458,62 @@ void windowfunction(double time[], double freq[], double weight[], size_t N,\
 void windowalpbet(double time[], double datasin[], double datacos[], size_t N,\
             double ny, double *alphasin, double *betasin, double *alphacos,\
             double *betacos)
+{
+    // Sums (ssin, csin, scos, ccos, cc, sc) over the chunks of the series
+    double sums[6];
+    struct windata data = {time, NULL, datasin, datacos};
+    chunk_sums(windowkernel, &data, N, ny, 6, sums);
+
+    // Calculate alpha and beta for both
+    wincoeffs(sums, N, alphasin, betasin, alphacos, betacos);
+}
+
+
+// Calculate alpha and beta coefficients WITH WEIGHTS
+void windowalpbetW(double time[], double weight[], double datasin[],\
+                   double datacos[], size_t N, double ny, double wsum,\
+                   double *alphasin, double *betasin, double *alphacos,\
+                   double *betacos)
+{
+    // Sums (ssin, csin, scos, ccos, cc, sc) over the chunks of the series
+    double sums[6];
+    struct windata data = {time, weight, datasin, datacos};
+    chunk_sums(windowWkernel, &data, N, ny, 6, sums);
+
+    // Calculate alpha and beta for both
+    wincoeffs(sums, wsum, alphasin, betasin, alphacos, betacos);
+}
+
+
+// Calculate alpha and beta for both data series from the sums
+void wincoeffs(double sums[], double wsum, double *alphasin, double *betasin,\
+               double *alphacos, double *betacos)
+{
+    double ssin = sums[0];
+    double csin = sums[1];
+    double scos = sums[2];
+    double ccos = sums[3];
+    double cc = sums[4];
+    double sc = sums[5];
+
+    // Calculate ss from cc
+    double ss = wsum - cc;
+
+    // Calculate alpha and beta for both 
+    double D = ss*cc - sc*sc;
+    *alphasin = (ssin * cc - csin * sc)/D;
+    *betasin  = (csin * ss - ssin * sc)/D;
+    *alphacos = (scos * cc - ccos * sc)/D;
+    *betacos  = (ccos * ss - scos * sc)/D;
+}
+
+
+// Kernel: Terms lo ... hi-1 of the sums (ssin, csin, scos, ccos, cc, sc)
+void windowkernel(size_t lo, size_t hi, double ny, void *data, double sums[])
 {
     // Auxiliary
-    double sn, cn, D;
+    struct windata* d = data;
+    double sn, cn;
     
     // Sums: Individual terms
     double ssin = 0;
@@ -120,45 +524,87 @@ void windowalpbet(double time[], double datasin[], double datacos[], size_t N,\
     // Sums: Common terms
     double cc = 0;
     double sc = 0;
-    double ss;
 
     // Loop over the time series
-    for (size_t i = 0; i < N; ++i) {
+    for (size_t i = lo; i < hi; ++i) {
         // Pre-calculate sin, cos of point
-        sn = sin(ny * time[i]);
-        cn = cos(ny * time[i]);
+        sn = sin(ny * d->time[i]);
+        cn = cos(ny * d->time[i]);
 
         // Calculate sin, cos terms for both data series
-        ssin += datasin[i] * sn;
-        csin += datasin[i] * cn;
-        scos += datacos[i] * sn;
-        ccos += datacos[i] * cn;
+        ssin += d->datasin[i] * sn;
+        csin += d->datasin[i] * cn;
+        scos += d->datacos[i] * sn;
+        ccos += d->datacos[i] * cn;
 
         // Calculate common squared and cross terms
         cc += cn * cn;
         sc += sn * cn;
     }
 
-    // Calculate ss from cc
-    ss = N - cc;
+    sums[0] = ssin;
+    sums[1] = csin;
+    sums[2] = scos;
+    sums[3] = ccos;
+    sums[4] = cc;
+    sums[5] = sc;
+}
 
-    // Calculate alpha and beta for both 
-    D = ss*cc - sc*sc;
-    *alphasin = (ssin * cc - csin * sc)/D;
-    *betasin  = (csin * ss - ssin * sc)/D;
-    *alphacos = (scos * cc - ccos * sc)/D;
-    *betacos  = (ccos * ss - scos * sc)/D;
+
+// Kernel: Terms lo ... hi-1 of the sums -- USING WEIGHTS
+void windowWkernel(size_t lo, size_t hi, double ny, void *data, double sums[])
+{
+    // Auxiliary
+    struct windata* d = data;
+    double sn, cn;
+    
+    // Sums: Individual terms
+    double ssin = 0;
+    double csin = 0;
+    double scos = 0;
+    double ccos = 0;
+
+    // Sums: Common terms
+    double cc = 0;
+    double sc = 0;
+
+    // Loop over the time series
+    for (size_t i = lo; i < hi; ++i) {
+        // Pre-calculate sin, cos of point
+        sn = sin(ny * d->time[i]);
+        cn = cos(ny * d->time[i]);
+
+        // Calculate sin, cos terms for both data series
+        // NOTE: The weights are already taken into account in the data!
+        ssin += d->weight[i] * d->datasin[i] * sn;
+        csin += d->weight[i] * d->datasin[i] * cn;
+        scos += d->weight[i] * d->datacos[i] * sn;
+        ccos += d->weight[i] * d->datacos[i] * cn;
+
+        // Calculate common squared and cross terms
+        cc += d->weight[i] * cn * cn;
+        sc += d->weight[i] * sn * cn;
+    }
+
+    sums[0] = ssin;
+    sums[1] = csin;
+    sums[2] = scos;
+    sums[3] = ccos;
+    sums[4] = cc;
+    sums[5] = sc;
 }
 
 
-// Calculate alpha and beta coefficients WITH WEIGHTS
-void windowalpbetW(double time[], double weight[], double datasin[],\
+// Calculate alpha and beta coefficients -- SINGLE-PRECISION SIN/COS
+//  --> For times `tc` centred around the middle of the series (see alpbetF)
+void windowalpbetF(double tc[], double weight[], double datasin[],\
                    double datacos[], size_t N, double ny, double wsum,\
-                   double *alphasin, double *betasin, double *alphacos,\
-                   double *betacos)
+                   int useweight, double *alphasin, double *betasin,\
+                   double *alphacos, double *betacos)
 {
     // Auxiliary
-    double sn, cn, D;
+    double x, w, D;
+    float sn, cn;
     
     // Sums: Individual terms
     double ssin = 0;
@@ -173,20 +619,22 @@ void windowalpbetW(double time[], double weight[], double datasin[],\
 
     // Loop over the time series
     for (size_t i = 0; i < N; ++i) {
-        // Pre-calculate sin, cos of point
-        sn = sin(ny * time[i]);
-        cn = cos(ny * time[i]);
+        // Phase reduced to [-pi, pi] and sin, cos of point
+        x = ny * tc[i];
+        x -= PI2 * rint(x / PI2);
+        sn = sinf((float) x);
+        cn = cosf((float) x);
 
         // Calculate sin, cos terms for both data series
-        // NOTE: The weights are already taken into account in the data!
-        ssin += weight[i] * datasin[i] * sn;
-        csin += weight[i] * datasin[i] * cn;
-        scos += weight[i] * datacos[i] * sn;
-        ccos += weight[i] * datacos[i] * cn;
+        w = (useweight != 0) ? weight[i] : 1.0;
+        ssin += w * datasin[i] * sn;
+        csin += w * datasin[i] * cn;
+        scos += w * datacos[i] * sn;
+        ccos += w * datacos[i] * cn;
 
         // Calculate common squared and cross terms
-        cc += weight[i] * cn * cn;
-        sc += weight[i] * sn * cn;
+        cc += w * cn * cn;
+        sc += w * sn * cn;
     }
 
     // Calculate ss from cc
@@ -201,6 +649,94 @@ void windowalpbetW(double time[], double weight[], double datasin[],\
 }
 
 
+/* Calculate the window function using FFTs of the sampling pattern
+ *  --> Returns 0 (and does nothing) if the times are not on a cadence grid or
+ *      the frequencies are not equidistant
+ *
+ * With Z(w) = sum_k weight_k exp(i w t_k), all of the sums in windowalpbetW
+ * are given by Z at the frequencies (ny - w0), (ny + w0) and 2ny. The
+ * weights are put on the cadence grid (zero in the gaps) and Z is evaluated
+ * at all of the frequencies using the chirp-z transform.
+ * Without weights the weights are all 1 (the sampling mask).
+ */
+int windowfft(struct series *s, double freq[], size_t M, double f0,\
+              double window[])
+{
+    double* time = s->time;
+    double* weight = s->weight;
+    size_t N = s->N;
+    int useweight = s->useweight;
+
+    // Check the sampling
+    double t0, dt;
+    size_t L = windowgrid(s, M);
+    if ( L == 0 ) return 0;
+    if ( arr_util_isuniform(freq, M, 1.0e-6) == 0 ) return 0;
+    series_grid(s, &t0, &dt);
+
+    // Put the weights on the grid
+    double complex* mask = calloc(L, sizeof(double complex));
+    double wsum = 0;
+    size_t n;
+    for (size_t k = 0; k < N; ++k) {
+        n = (size_t) llround((time[k] - t0) / dt);
+        if ( useweight == 0 ) {
+            mask[n] += 1.0;
+            wsum += 1.0;
+        }
+        else {
+            mask[n] += weight[k];
+            wsum += weight[k];
+        }
+    }
+
+    // Z at (ny - w0), (ny + w0) and 2ny for all ny (angles per grid step)
+    double omega0 = f0 * PI2micro;
+    double nyfirst = freq[0] * PI2micro;
+    double dny = (freq[M-1] - freq[0]) / (M-1) * PI2micro;
+    double complex* zm = malloc(M * sizeof(double complex));
+    double complex* zp = malloc(M * sizeof(double complex));
+    double complex* z2 = malloc(M * sizeof(double complex));
+    czt(mask, L, (nyfirst - omega0) * dt, dny * dt, M, zm);
+    czt(mask, L, (nyfirst + omega0) * dt, dny * dt, M, zp);
+    czt(mask, L, 2 * nyfirst * dt, 2 * dny * dt, M, z2);
+
+    // Calculate the window
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t i = 0; i < M; ++i) {
+        // Shift of the time origin from zero to t0
+        double ny = nyfirst + i * dny;
+        double complex a = zm[i] * cexp(I * (ny - omega0) * t0);
+        double complex b = zp[i] * cexp(I * (ny + omega0) * t0);
+        double complex c = z2[i] * cexp(I * 2 * ny * t0);
+
+        // Sums as in windowalpbetW
+        double ssin = 0.5 * creal(a - b);
+        double ccos = 0.5 * creal(a + b);
+        double csin = 0.5 * cimag(b - a);
+        double scos = 0.5 * cimag(b + a);
+        double cc = 0.5 * (wsum + creal(c));
+        double sc = 0.5 * cimag(c);
+        double ss = wsum - cc;
+
+        // Calculate alpha and beta for both and store power
+        double D = ss*cc - sc*sc;
+        double alphasin = (ssin * cc - csin * sc)/D;
+        double betasin  = (csin * ss - ssin * sc)/D;
+        double alphacos = (scos * cc - ccos * sc)/D;
+        double betacos  = (ccos * ss - scos * sc)/D;
+        window[i] = 0.5 * ( (alphasin*alphasin + betasin*betasin) + \
+                            (alphacos*alphacos + betacos*betacos)    );
+    }
+
+    // Done
+    free(mask);
+    free(zm);
+    free(zp);
+    free(z2);
+    return 1;
+}
+
 
 /* Calculate the sum of the spectral window
  *
@@ -213,13 +749,42 @@ void windowalpbetW(double time[], double weight[], double datasin[],\
  * - `N`          : Length of the time series
  * - `useweight`  : If != 0 weights will be used.
  * - `quiet`      : If != 0 no output will be displayed to console
+ *
+ * Note: The sum is looked up in (and stored to) the window cache.
  */
 double windowsum(double f0, double low, double high, double rate, double time[],
                  double weight[], size_t N, int useweight, int quiet)
+{
+    struct series ser;
+    series_wrap(&ser, time, NULL, weight, N, useweight);
+    double result = windowsum_series(&ser, f0, low, high, rate, quiet);
+    series_free(&ser);
+    return result;
+}
+
+
+/* Calculate the sum of the spectral window of a prepared time series
+ *  --> As windowsum(), see windowfunction_series
+ */
+double windowsum_series(struct series *s, double f0, double low, double high,\
+                        double rate, int quiet)
 {
     // Init
     double result = 0;
 
+    // Look for the sum in the cache
+    double param[WINKEYS+3];
+    winparam(param, f0);
+    param[WINKEYS] = low;
+    param[WINKEYS+1] = high;
+    param[WINKEYS+2] = rate;
+    uint64_t key = winkey(s, param, WINKEYS+3);
+    if ( wincache_load(key, "winsum", &result, 1) != 0 ) {
+        if ( quiet == 0 )
+            printf(" -- INFO: Sum of the window found in the cache\n");
+        return result;
+    }
+
     // Calculate length of sampling vector
     size_t M = arr_util_getstep(low, high, rate);
     if ( quiet == 0 )
@@ -232,10 +797,11 @@ double windowsum(double f0, double low, double high, double rate, double time[],
     arr_init_linspace(freq, low, rate, M);
 
     // Calculate spectral window with or without weights
-    windowfunction(time, freq, weight, N, M, f0, window, useweight);
+    windowfunction_series(s, freq, M, f0, window);
 
-    // Calculate the sum
+    // Calculate the sum (and save it for later runs)
     result = arr_sum(window, M);
+    wincache_store(key, "winsum", &result, 1);
     
     // Done
     free(freq);
@@ -1,7 +1,22 @@
 void windowfunction(double time[], double freq[], double weight[], size_t N,
                      size_t M, double f0, double window[], int useweight);
 
+void windowmulti(double time[], double delta[], double weight[], size_t N,\
+                 size_t M, double f0[], size_t K, double window[],\
+                 int useweight);
+
 double windowsum(double f0, double low, double high, double rate, double time[],
                  double weight[], size_t N, int useweight, int quiet);
 
 
+
+struct series;
+
+void windowfunction_series(struct series *s, double freq[], size_t M,\
+                           double f0, double window[]);
+
+void windowmulti_series(struct series *s, double delta[], size_t M,\
+                        double f0[], size_t K, double window[]);
+
+double windowsum_series(struct series *s, double f0, double low, double high,\
+                        double rate, int quiet);
@@ -0,0 +1,118 @@
+/*  ~~~ Time Series Analysis -- Auxiliary ~~~
+ *
+ * Fourier sums in a narrow band by heterodyning and decimation
+ *
+ * The series is mixed down by the centre of the band and decimated into
+ * bins much longer than the cadence. The bin moments (powers of the time
+ * offset from the bin centre) make the decimation exact: the remaining phase
+ * inside a bin is expanded in a Taylor series, which converges quickly since
+ * the offsets from the band centre are small. The sums of the short, complex
+ * series of bins are evaluated using chirp-z transforms.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <omp.h>
+
+#include "fft.h"
+
+// Max. phase drift across half a bin at the band edges, and the number of
+// terms in the Taylor expansion (error < ZOOMTHETA^ZOOMTERMS / ZOOMTERMS!)
+#define ZOOMTHETA 2.0
+#define ZOOMTERMS 24
+
+
+/* Number of bins needed for the band [wa, wa + (M-1)*dw]
+ *
+ * Arguments:
+ *  - `time`: Array of times (ascending). In seconds!
+ *  - `N`   : Length of the time series
+ *  - `dw`  : Spacing of the angular frequencies
+ *  - `M`   : Number of frequencies
+ *  - `tbin`: OUTPUT -- Length of the bins (in seconds)
+ */
+size_t zoom_nbins(double time[], size_t N, double dw, size_t M, double *tbin)
+{
+    double span = time[N-1] - time[0];
+    double halfwidth = 0.5 * (M-1) * fabs(dw);
+
+    // Bins from the allowed phase drift (one bin for a single frequency)
+    if ( halfwidth * span < ZOOMTHETA ) *tbin = span + 1.0;
+    else *tbin = 2.0 * ZOOMTHETA / halfwidth;
+
+    return (size_t) (span / *tbin) + 1;
+}
+
+
+/* Number of terms (moments per bin) of the expansion */
+size_t zoom_terms(void)
+{
+    return ZOOMTERMS;
+}
+
+
+/* Calculate the Fourier sums
+ *     out[j] = sum_k x[k] * exp(i * (wa + j*dw) * time[k]),   j = 0 ... M-1
+ *
+ * Arguments:
+ *  - `time`: Array of times (ascending). In seconds!
+ *  - `x`   : Array of (real) data.
+ *  - `N`   : Length of the time series
+ *  - `wa`  : First angular frequency (radians per second)
+ *  - `dw`  : Spacing of the angular frequencies
+ *  - `M`   : Number of frequencies
+ *  - `out` : OUTPUT -- Array (complex) with the sums
+ */
+void zoomsum(double time[], double x[], size_t N, double wa, double dw,\
+             size_t M, double complex out[])
+{
+    // Centre of the band and the bins
+    double wc = wa + 0.5 * (M-1) * dw;
+    double tbin;
+    size_t L = zoom_nbins(time, N, dw, M, &tbin);
+    double half = 0.5 * tbin;
+    double tstart = time[0];
+
+    // Mix down and accumulate the moments of each bin
+    //  - mom[p*L + m] = sum_{k in bin m} x_k exp(i wc t_k) v_k^p / p!
+    //    with v_k the offset from the centre of the bin in units of `half`
+    double complex* mom = calloc(ZOOMTERMS * L, sizeof(double complex));
+    size_t m;
+    double v, vp;
+    double complex mixed;
+    for (size_t k = 0; k < N; ++k) {
+        m = (size_t) ((time[k] - tstart) / tbin);
+        if ( m >= L ) m = L-1;
+        v = (time[k] - tstart - (m + 0.5) * tbin) / half;
+        mixed = x[k] * cexp(I * wc * time[k]);
+        vp = 1.0;
+        for (size_t p = 0; p < ZOOMTERMS; ++p) {
+            mom[p*L + m] += mixed * vp;
+            vp *= v / (p + 1);
+        }
+    }
+
+    // Sums of each moment over the bins at the offsets from the band centre
+    double complex* sums = malloc(ZOOMTERMS * M * sizeof(double complex));
+    for (size_t p = 0; p < ZOOMTERMS; ++p) {
+        czt(&mom[p*L], L, (wa - wc) * tbin, dw * tbin, M, &sums[p*M]);
+    }
+
+    // Combine the terms (Horner) and shift to the centre of the first bin
+    #pragma omp parallel for default(shared) schedule(static)
+    for (size_t j = 0; j < M; ++j) {
+        double delta = wa + j*dw - wc;
+        double complex step = I * delta * half;
+        double complex total = sums[(ZOOMTERMS-1)*M + j];
+        for (size_t p = ZOOMTERMS-1; p > 0; --p) {
+            total = total * step + sums[(p-1)*M + j];
+        }
+        out[j] = total * cexp(I * delta * (tstart + half));
+    }
+
+    // Done
+    free(mom);
+    free(sums);
+}
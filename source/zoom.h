@@ -0,0 +1,6 @@
+size_t zoom_nbins(double time[], size_t N, double dw, size_t M, double *tbin);
+
+size_t zoom_terms(void);
+
+void zoomsum(double time[], double x[], size_t N, double wa, double dw,\
+             size_t M, double complex out[]);